@@ -25,14 +25,20 @@
 #include <vector>
 #include <mutex>
 #include <unordered_map>
+#include <unordered_set>
 #include <string>
 #include <sstream>
 #include <cmath>
 #include <memory>
 #include <atomic>
+#include <type_traits>  // std::extent (shared memory schema)
 #include <queue>
-#include <iomanip>  // For std::setprecision y std::fixed
+#include <deque>
+#include <condition_variable>
+#include <charconv> // std::to_chars (JSON frame encoder), std::from_chars (command parser)
+#include <string_view>
 #include <cmath>    // For std::isfinite
+#include <intrin.h> // _BitScanForward (change journal)
 
 #pragma comment(lib, "ws2_32.lib")
 
@@ -161,14 +167,63 @@ void HybridLogToFile(const std::string& message) {
 // OPTIMIZED DATA STRUCTURE - All 339 Variables Organized
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-struct AeroflyBridgeData {
-    // === HEADER (16 bytes) ===
+// Atomic view of a uint32_t that lives in shared memory (std::atomic_ref is C++20;
+// std::atomic<uint32_t> is layout-compatible with uint32_t)
+inline std::atomic<uint32_t>& SharedAtomic(uint32_t& word) {
+    return *reinterpret_cast<std::atomic<uint32_t>*>(&word);
+}
+inline const std::atomic<uint32_t>& SharedAtomic(const uint32_t& word) {
+    return *reinterpret_cast<const std::atomic<uint32_t>*>(&word);
+}
+
+// Change journal bitmaps: one bit per variable, 32 per word
+inline bool TestChangedBit(const uint32_t* bitmap, uint32_t index) {
+    return (bitmap[index >> 5] >> (index & 31)) & 1;
+}
+inline void SetChangedBit(uint32_t* bitmap, uint32_t index) {
+    bitmap[index >> 5] |= 1u << (index & 31);
+}
+
+// Writes the indices of all set bits in ascending order; returns how many were written
+template <typename IndexType>
+inline uint32_t ExtractChangedIndices(const uint32_t* bitmap, uint32_t word_count, IndexType* out) {
+    uint32_t count = 0;
+    for (uint32_t w = 0; w < word_count; w++) {
+        unsigned long word = bitmap[w];
+        unsigned long bit;
+        while (_BitScanForward(&bit, word)) {
+            out[count++] = (IndexType)(w * 32 + bit);
+            word &= word - 1;
+        }
+    }
+    return count;
+}
+
+// Per-frame part of the mapping (layout v2): header, named fields and all_variables[339].
+// Fields are grouped by how often they change and every group starts on its own cache line,
+// so a frame in which only the flight path moves dirties the header, the hot groups and
+// all_variables, while radios, autopilot targets and V-speeds stay clean in the readers' caches.
+// AeroflyBridgeData extends it with the dynamic/hybrid sections; the frame slots in
+// "AeroflyBridgeFrames" hold complete copies of it.
+struct AeroflyFrameData {
+    // === HEADER (64 bytes, own cache line) ===
     uint64_t timestamp_us;           // Microseconds since start
     uint32_t data_valid;            // 1 = valid data, 0 = invalid
     uint32_t update_counter;        // Increments each update
+    uint32_t frame_sequence;        // Seqlock word: odd while a frame is being written, even when stable
+    uint32_t layout_version;        // AeroflyBridgeData::LAYOUT_VERSION
+    uint32_t reserved_header[10];   // Keeps the header alone on its cache line
 
-    // === AIRCRAFT BASIC (64 bytes) ===
-    double latitude;                // Aircraft.Latitude (radians)
+    // === CHANGE JOURNAL (written each frame) ===
+    // Variables whose stored value changed in this frame compared to the previous one. Covers this
+    // frame only: a reader that skipped frames (update_counter jumped) must re-read everything.
+    static constexpr uint32_t CHANGED_BITMAP_WORDS = (339 + 31) / 32;
+    alignas(64) uint32_t changed_count;   // Valid entries in changed_indices
+    uint32_t changed_bitmap[CHANGED_BITMAP_WORDS]; // Bit i = all_variables[i] (or its Vector3d/string field) changed
+    uint16_t changed_indices[339];        // Changed variable indices, ascending
+
+    // === HOT: POSITION & ATTITUDE (64 bytes) ===
+    alignas(64) double latitude;    // Aircraft.Latitude (radians)
     double longitude;               // Aircraft.Longitude (radians)
     double altitude;                // Aircraft.Altitude (meters)
     double pitch;                   // Aircraft.Pitch (radians)
@@ -177,8 +232,8 @@ struct AeroflyBridgeData {
     double magnetic_heading;        // Aircraft.MagneticHeading (radians)
     double indicated_airspeed;      // Aircraft.IndicatedAirspeed (m/s)
 
-    // === AIRCRAFT PHYSICS (96 bytes) ===
-    double ground_speed;            // Aircraft.GroundSpeed (m/s)
+    // === HOT: MOTION (192 bytes) ===
+    alignas(64) double ground_speed; // Aircraft.GroundSpeed (m/s)
     double vertical_speed;          // Aircraft.VerticalSpeed (m/s)
     double angle_of_attack;         // Aircraft.AngleOfAttack (radians)
     double angle_of_attack_limit;   // Aircraft.AngleOfAttackLimit (radians)
@@ -191,28 +246,30 @@ struct AeroflyBridgeData {
     tm_vector3d wind;              // Aircraft.Wind (m/s)
     tm_vector3d gravity;           // Aircraft.Gravity (m/s²)
 
-    // === AIRCRAFT STATE (64 bytes) ===
-    double on_ground;              // Aircraft.OnGround (0/1)
+    // === HOT: CONTROLS & ENGINES (96 bytes) ===
+    alignas(64) double pitch_input; // Controls.Pitch.Input (-1 to +1)
+    double roll_input;             // Controls.Roll.Input (-1 to +1)
+    double yaw_input;              // Controls.Yaw.Input (-1 to +1)
+    double throttle_position;      // Aircraft.Throttle (0-1)
+    double engine_throttle[4];     // Aircraft.EngineThrottle1-4 (0-1)
+    double engine_rotation_speed[4]; // Aircraft.EngineRotationSpeed1-4
+
+    // === WARM: AIRCRAFT STATE & WARNINGS (104 bytes) ===
+    alignas(64) double on_ground;  // Aircraft.OnGround (0/1)
     double on_runway;              // Aircraft.OnRunway (0/1)
     double crashed;                // Aircraft.Crashed (0/1)
     double gear_position;          // Aircraft.Gear (0-1)
     double flaps_position;         // Aircraft.Flaps (0-1)
     double slats_position;         // Aircraft.Slats (0-1)
-    double throttle_position;      // Aircraft.Throttle (0-1)
     double airbrake_position;      // Aircraft.AirBrake (0-1)
-
-    // === ENGINE DATA (32 bytes) ===
-    double engine_throttle[4];     // Aircraft.EngineThrottle1-4 (0-1)
-    double engine_rotation_speed[4]; // Aircraft.EngineRotationSpeed1-4
     double engine_running[4];      // Aircraft.EngineRunning1-4 (0/1)
+    uint32_t warning_flags;        // Bitfield for all warnings
+    uint32_t master_warning;       // Warnings.MasterWarning
+    uint32_t master_caution;       // Warnings.MasterCaution
+    uint32_t reserved_state;
 
-    // === CONTROLS INPUT (24 bytes) ===
-    double pitch_input;            // Controls.Pitch.Input (-1 to +1)
-    double roll_input;             // Controls.Roll.Input (-1 to +1)
-    double yaw_input;              // Controls.Yaw.Input (-1 to +1)
-
-    // === NAVIGATION FREQUENCIES (80 bytes) ===
-    double com1_frequency;         // Communication.COM1Frequency (Hz)
+    // === COLD: NAVIGATION FREQUENCIES (80 bytes) ===
+    alignas(64) double com1_frequency; // Communication.COM1Frequency (Hz)
     double com1_standby_frequency; // Communication.COM1StandbyFrequency (Hz)
     double com2_frequency;         // Communication.COM2Frequency (Hz)
     double com2_standby_frequency; // Communication.COM2StandbyFrequency (Hz)
@@ -223,7 +280,7 @@ struct AeroflyBridgeData {
     double nav2_standby_frequency; // Navigation.NAV2StandbyFrequency (Hz)
     double nav2_selected_course;   // Navigation.SelectedCourse2 (radians)
 
-    // === AUTOPILOT (64 bytes) ===
+    // === COLD: AUTOPILOT (80 bytes) ===
     double ap_engaged;             // Autopilot.Engaged (0/1)
     double ap_selected_airspeed;   // Autopilot.SelectedAirspeed (m/s)
     double ap_selected_heading;    // Autopilot.SelectedHeading (radians)
@@ -233,24 +290,36 @@ struct AeroflyBridgeData {
     char ap_lateral_mode[16];      // Autopilot.ActiveLateralMode
     char ap_vertical_mode[16];     // Autopilot.ActiveVerticalMode
 
-    // === PERFORMANCE SPEEDS (40 bytes) ===
+    // === COLD: PERFORMANCE SPEEDS (40 bytes) ===
     double vs0_speed;              // Performance.Speed.VS0 (m/s)
     double vs1_speed;              // Performance.Speed.VS1 (m/s)
     double vfe_speed;              // Performance.Speed.VFE (m/s)
     double vno_speed;              // Performance.Speed.VNO (m/s)
     double vne_speed;              // Performance.Speed.VNE (m/s)
 
-    // === WARNINGS (16 bytes) ===
-    uint32_t warning_flags;        // Bitfield for all warnings
-    uint32_t master_warning;       // Warnings.MasterWarning
-    uint32_t master_caution;       // Warnings.MasterCaution
-    uint32_t reserved_warnings;    // For future use
-
     // === ALL VARIABLES ARRAY (2712 bytes) - Complete Access ===
-    double all_variables[339];     // 339 variables by index (complete SDK coverage)
+    alignas(64) double all_variables[339]; // 339 variables by index (complete SDK coverage)
+
+    std::atomic<uint32_t>& Sequence() { return SharedAtomic(frame_sequence); }
+    const std::atomic<uint32_t>& Sequence() const { return SharedAtomic(frame_sequence); }
 
-    // === DYNAMIC VARIABLES SYSTEM (NEW) ===
-    uint32_t dynamic_count;          // Number of active dynamic variables
+    bool VariableChanged(int index) const { return TestChangedBit(changed_bitmap, (uint32_t)index); }
+};
+
+struct AeroflyBridgeData : AeroflyFrameData {
+    static constexpr uint32_t LAYOUT_VERSION = 3;   // Bumped whenever a field moves (see "AeroflyBridgeSchema")
+
+    // === CHANGE NOTIFICATION (64 bytes, written each frame) ===
+    alignas(64) uint32_t group_changed_frame[16]; // Per VariableGroup: update_counter of the last frame that changed it
+
+    // === DYNAMIC VARIABLE VALUES (written each frame) ===
+    static constexpr uint32_t DYNAMIC_CHANGED_WORDS = (5000 + 31) / 32;
+    alignas(64) uint32_t dynamic_changed_count;              // Dynamic values changed in this frame
+    uint32_t dynamic_changed_bitmap[DYNAMIC_CHANGED_WORDS];  // Bit i = dynamic_values[i] changed in this frame
+    alignas(64) double dynamic_values[5000]; // Indexed by DynamicVariableEntry::value_index
+
+    // === DYNAMIC VARIABLES CATALOG (own pages, written at discovery only) ===
+    alignas(4096) uint32_t dynamic_count; // Number of active dynamic variables
     uint32_t dynamic_capacity;       // Maximum capacity (5000)
 
     // Hash-based lookup table for O(1) average access
@@ -263,9 +332,6 @@ struct AeroflyBridgeData {
         uint16_t category_id;        // Category (0=Controls, 1=Navigation, 2=Engine, etc.)
     } dynamic_lookup[5000];
 
-    // Values array - aligned for fast access
-    double dynamic_values[5000];
-
     // Category index for efficient browsing
     struct CategoryInfo {
         char name[32];               // Category name ("Controls", "Navigation", etc.)
@@ -282,14 +348,37 @@ struct AeroflyBridgeData {
     } aircraft[50];                  // Up to 50 aircraft
     uint32_t aircraft_count;
 
-    // === HYBRID SYSTEM INFO ===
-    uint32_t hybrid_core_variables;        // Number of core variables available
+    // Open-addressing table over dynamic_lookup keyed by ComputeHash(name), linear probing.
+    // 0 = empty slot, otherwise dynamic_lookup index + 1. Written only by the bridge.
+    static constexpr uint32_t DYNAMIC_BUCKET_COUNT = 8192;  // Power of two, load factor <= 0.61 at full capacity
+    uint16_t dynamic_buckets[DYNAMIC_BUCKET_COUNT];
+
+    // === HYBRID SYSTEM INFO (own page, written outside the frame loop) ===
+    alignas(4096) uint32_t hybrid_core_variables; // Number of core variables available
     uint32_t hybrid_dynamic_variables;     // Number of dynamic variables created
     uint32_t hybrid_discovered_variables;  // Number of variables discovered
     uint32_t hybrid_discovery_complete;    // 1 = discovery complete, 0 = in progress
     char aerofly_path[256];                // Path to Aerofly installation (null-terminated)
     uint32_t reserved_hybrid[11];          // For future hybrid features
 
+    // === FRAME-CONSISTENT READS (SEQLOCK) ===
+
+    // Runs 'read' (which copies whatever fields it needs) until it did not overlap a frame write.
+    // The writer never waits for readers; a reader only retries while the sim thread is writing.
+    //   pData->ReadConsistent([&](const AeroflyBridgeData& d) { lat = d.latitude; lon = d.longitude; });
+    template <typename ReadFn>
+    void ReadConsistent(ReadFn&& read) const {
+        for (;;) {
+            const uint32_t begin = Sequence().load(std::memory_order_acquire);
+            if ((begin & 1) == 0) {
+                read(*this);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (Sequence().load(std::memory_order_relaxed) == begin) return;
+            }
+            YieldProcessor();
+        }
+    }
+
     // === INLINE SEARCH FUNCTIONS ===
 
     // Fast hash function for variable names
@@ -301,21 +390,24 @@ struct AeroflyBridgeData {
         return hash;
     }
 
-    // Find dynamic variable by name - O(1) average case
+    // Find dynamic variable by name - O(1) average case, never writes to the mapping
     int FindDynamicVariable(const char* name) const {
-        if (!name || dynamic_count == 0) return -1;
+        if (!name) return -1;
+        const uint32_t count = SharedAtomic(dynamic_count).load(std::memory_order_acquire);
+        if (count == 0) return -1;
         
-        uint32_t hash = ComputeHash(name);
+        const uint32_t hash = ComputeHash(name);
+        const uint32_t mask = DYNAMIC_BUCKET_COUNT - 1;
         
-        // Linear probe with hash comparison first (faster than string compare)
-        for (uint32_t i = 0; i < dynamic_count; i++) {
-            if (dynamic_lookup[i].name_hash == hash) {
-                // Hash match - verify with string comparison
-                if (strcmp(dynamic_lookup[i].name, name) == 0) {
-                    // Found! Increment access counter for optimization tracking
-                    const_cast<DynamicVariableEntry&>(dynamic_lookup[i]).access_count++;
-                    return dynamic_lookup[i].value_index;
-                }
+        for (uint32_t probe = 0, slot = hash & mask; probe < DYNAMIC_BUCKET_COUNT; probe++, slot = (slot + 1) & mask) {
+            const uint32_t entry = dynamic_buckets[slot];
+            if (entry == 0) break;             // Empty slot ends the probe sequence
+            if (entry > count) continue;       // Entry still being published
+            
+            const DynamicVariableEntry& candidate = dynamic_lookup[entry - 1];
+            // Hash match first (faster than string compare)
+            if (candidate.name_hash == hash && strncmp(candidate.name, name, sizeof(candidate.name)) == 0) {
+                return candidate.value_index;
             }
         }
         return -1; // Not found
@@ -327,9 +419,437 @@ struct AeroflyBridgeData {
         return (index >= 0) ? dynamic_values[index] : default_value;
     }
 
-    // NOTE: Updated total size: ~3688 bytes (with hybrid system support)
+    // NOTE: Total size is ~470 KB with the dynamic catalog; size views from AeroflyBridgeSchema::data_size
     };
 
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) && std::atomic<uint32_t>::is_always_lock_free,
+              "frame_sequence must be usable as a lock-free atomic across processes");
+static_assert(offsetof(AeroflyFrameData, changed_count) == 64 && offsetof(AeroflyFrameData, latitude) % 64 == 0 &&
+              offsetof(AeroflyFrameData, ground_speed) % 64 == 0 && offsetof(AeroflyFrameData, pitch_input) % 64 == 0 &&
+              sizeof(AeroflyFrameData) % 64 == 0,
+              "Layout v2: header and hot groups each start on their own cache line");
+static_assert(offsetof(AeroflyBridgeData, group_changed_frame) == sizeof(AeroflyFrameData),
+              "Layout v2: bridge sections start after the whole frame (no reuse of its tail padding)");
+static_assert(offsetof(AeroflyBridgeData, dynamic_count) % 4096 == 0 && offsetof(AeroflyBridgeData, hybrid_core_variables) % 4096 == 0,
+              "Layout v2: the dynamic catalog and hybrid info live on their own pages");
+static_assert((AeroflyBridgeData::DYNAMIC_BUCKET_COUNT & (AeroflyBridgeData::DYNAMIC_BUCKET_COUNT - 1)) == 0 &&
+              AeroflyBridgeData::DYNAMIC_BUCKET_COUNT > sizeof(AeroflyBridgeData::dynamic_lookup) / sizeof(AeroflyBridgeData::dynamic_lookup[0]),
+              "dynamic_buckets must be a power of two larger than dynamic_lookup");
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// TRIPLE-BUFFERED FRAME SLOTS - Optional "AeroflyBridgeFrames" mapping
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Three complete copies of AeroflyFrameData. The writer fills the slot after the latest one
+// and publishes it by storing latest_slot, so a reader never sees a slot being written as long
+// as it is done with it within two frame periods (~33 ms at 60 Hz). Each slot also carries a
+// sequence word (odd while being rewritten), so a reader preempted for longer detects the torn
+// copy instead of using it; ReadLatestFrame() does this and retries only in that case.
+//   AeroflyFrameData frame; pFrames->ReadLatestFrame(frame);
+struct AeroflyFrameBuffer {
+    static constexpr uint32_t MAGIC = 0x42544641;   // "AFTB"
+    static constexpr uint32_t VERSION = 3;          // Follows AeroflyBridgeData::LAYOUT_VERSION
+    static constexpr uint32_t SLOT_COUNT = 3;
+
+    uint32_t magic;                 // MAGIC once the mapping is initialized
+    uint32_t version;               // VERSION
+    uint32_t slot_count;            // SLOT_COUNT
+    uint32_t slot_size;             // sizeof(FrameSlot)
+    uint32_t latest_slot;           // Index of the most recently published slot (atomic)
+    uint32_t published_frames;      // Frames published so far
+    uint32_t reserved[10];          // Pads the control block to 64 bytes
+
+    struct alignas(64) FrameSlot {
+        AeroflyFrameData frame;
+        uint32_t sequence;          // Odd while the writer copies into this slot (atomic)
+        uint32_t reserved[15];
+
+        std::atomic<uint32_t>& Sequence() { return SharedAtomic(sequence); }
+        const std::atomic<uint32_t>& Sequence() const { return SharedAtomic(sequence); }
+    } slots[SLOT_COUNT];
+
+    std::atomic<uint32_t>& LatestSlot() { return SharedAtomic(latest_slot); }
+    const std::atomic<uint32_t>& LatestSlot() const { return SharedAtomic(latest_slot); }
+
+    // Zero-copy access; only safe for readers that finish within two frame periods
+    const AeroflyFrameData& LatestFrame() const {
+        return slots[LatestSlot().load(std::memory_order_acquire) % SLOT_COUNT].frame;
+    }
+
+    // Copies the latest frame, validated against the slot sequence
+    void ReadLatestFrame(AeroflyFrameData& out) const {
+        for (;;) {
+            const FrameSlot& slot = slots[LatestSlot().load(std::memory_order_acquire) % SLOT_COUNT];
+            const uint32_t begin = slot.Sequence().load(std::memory_order_acquire);
+            if ((begin & 1) == 0) {
+                memcpy(&out, &slot.frame, sizeof(AeroflyFrameData));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.Sequence().load(std::memory_order_relaxed) == begin) return;
+            }
+            YieldProcessor();
+        }
+    }
+
+    // Writer side: copy a finished frame into the back slot, then flip the index
+    void Publish(const AeroflyFrameData& frame) {
+        const uint32_t back = (LatestSlot().load(std::memory_order_relaxed) + 1) % SLOT_COUNT;
+        FrameSlot& slot = slots[back];
+        std::atomic<uint32_t>& sequence = slot.Sequence();
+        const uint32_t begin = sequence.load(std::memory_order_relaxed) | 1;
+        sequence.store(begin, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(&slot.frame, &frame, sizeof(AeroflyFrameData));
+        sequence.store(begin + 1, std::memory_order_release);
+        published_frames++;
+        LatestSlot().store(back, std::memory_order_release);
+    }
+};
+
+static_assert(offsetof(AeroflyFrameBuffer, slots) == 64 && sizeof(AeroflyFrameBuffer::FrameSlot) % 64 == 0 &&
+              offsetof(AeroflyFrameBuffer::FrameSlot, sequence) == sizeof(AeroflyFrameData),
+              "Frame slots start on their own cache line, sequence word after the frame");
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// FRAME HISTORY RING - Optional "AeroflyBridgeHistory" mapping
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct AeroflyHistoryEntry {
+    uint64_t timestamp_us;          // Same as AeroflyFrameData::timestamp_us of that frame
+    uint32_t update_counter;        // Frame number; 0 while the entry is being rewritten
+    uint32_t reserved;
+    double delta_time;              // Simulator delta time of that frame (seconds)
+    double all_variables[339];
+};
+
+// Last 'capacity' frames of all_variables[], frame F stored at entry F % capacity.
+// Readers that fell behind (GC pause, scheduling hiccup) catch up from here instead of
+// polling at sim rate; entries are exact sim frames, so derivatives can use delta_time.
+//   for (uint32_t f = last_seen + 1; f <= pHistory->LatestFrame(); f++) pHistory->ReadFrame(f, entry);
+struct AeroflyHistoryRing {
+    static constexpr uint32_t MAGIC = 0x53484641;   // "AFHS"
+    static constexpr uint32_t VERSION = 1;
+
+    uint32_t magic;                 // MAGIC once the mapping is initialized
+    uint32_t version;               // VERSION
+    uint32_t capacity;              // Number of entries following this header
+    uint32_t entry_size;            // sizeof(AeroflyHistoryEntry)
+    uint32_t latest_frame;          // update_counter of the newest complete entry (atomic)
+    uint32_t reserved[11];          // Pads the header to 64 bytes
+
+    static size_t SizeFor(uint32_t capacity) {
+        return 64 + (size_t)capacity * sizeof(AeroflyHistoryEntry);
+    }
+
+    AeroflyHistoryEntry* Entries() {
+        return reinterpret_cast<AeroflyHistoryEntry*>(reinterpret_cast<uint8_t*>(this) + 64);
+    }
+    const AeroflyHistoryEntry* Entries() const {
+        return reinterpret_cast<const AeroflyHistoryEntry*>(reinterpret_cast<const uint8_t*>(this) + 64);
+    }
+
+    uint32_t LatestFrame() const {
+        return SharedAtomic(latest_frame).load(std::memory_order_acquire);
+    }
+
+    // Copies frame 'update_counter' into 'out'; false if it was never written or already overwritten
+    bool ReadFrame(uint32_t update_counter, AeroflyHistoryEntry& out) const {
+        if (capacity == 0 || update_counter == 0) return false;
+        const AeroflyHistoryEntry& entry = Entries()[update_counter % capacity];
+        if (SharedAtomic(entry.update_counter).load(std::memory_order_acquire) != update_counter) return false;
+        memcpy(&out, &entry, sizeof(AeroflyHistoryEntry));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return SharedAtomic(entry.update_counter).load(std::memory_order_relaxed) == update_counter;
+    }
+
+    // Writer side: one contiguous store of the frame, then publish its counter
+    void Append(const AeroflyFrameData& frame, double delta_time) {
+        if (capacity == 0 || frame.update_counter == 0) return;
+        AeroflyHistoryEntry& entry = Entries()[frame.update_counter % capacity];
+        SharedAtomic(entry.update_counter).store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        entry.timestamp_us = frame.timestamp_us;
+        entry.delta_time = delta_time;
+        memcpy(entry.all_variables, frame.all_variables, sizeof(entry.all_variables));
+
+        SharedAtomic(entry.update_counter).store(frame.update_counter, std::memory_order_release);
+        SharedAtomic(latest_frame).store(frame.update_counter, std::memory_order_release);
+    }
+};
+
+static_assert(sizeof(AeroflyHistoryRing) == 64, "History entries start right after the 64-byte header");
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// COMMAND RING - "AeroflyBridgeCommands" mapping for same-host clients
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum class AeroflyCommandQualifier : uint32_t { Value, Move, Offset, Step, Toggle, Active, Event };
+enum class AeroflyCommandStatus : uint32_t { Applied = 1, Rejected = 2 };
+
+// One command, the same as a JSON command with a handle (or name hash) and qualifier
+struct AeroflyCommand {
+    uint32_t handle;                // Resolved handle, or 0xFFFFFFFF to look up name_hash instead
+    uint32_t qualifier;             // AeroflyCommandQualifier
+    uint64_t name_hash;             // tm_string_hash of the variable name (handle == 0xFFFFFFFF)
+    double value;
+    uint32_t client_id;             // Chosen by the client, echoed in its completions
+    uint32_t client_sequence;       // Chosen by the client, echoed in its completions
+};
+
+struct AeroflyCommandCell {
+    uint32_t sequence;              // Ring protocol, see AeroflyCommandRing
+    uint32_t reserved;
+    AeroflyCommand command;
+    uint8_t padding[64 - 8 - sizeof(AeroflyCommand)];
+};
+
+// Written by the bridge once a command has been turned into a message for the simulator
+struct AeroflyCommandCompletion {
+    uint32_t position;              // Completion number + 1 once written, 0 while being rewritten
+    uint32_t client_id;
+    uint32_t client_sequence;
+    uint32_t status;                // AeroflyCommandStatus
+    uint32_t frame;                 // update_counter of the frame that applied it
+    uint32_t reserved[3];
+};
+
+// Bounded multi-producer queue (Vyukov): any number of client processes claim a cell with one
+// compare-exchange and publish it through its sequence; the bridge drains it once per frame
+// without locks. Completions are a broadcast ring like AeroflyHistoryRing: completion N sits at
+// N % COMPLETION_CAPACITY, and each client filters for its own client_id.
+//   AeroflyCommand c = { handle, (uint32_t)AeroflyCommandQualifier::Value, 0, 0.75, my_id, ++my_sequence };
+//   while (!pRing->TryPush(c)) { /* full: the bridge drains once per sim frame */ }
+// A producer that dies between claiming and publishing a cell stalls the queue behind it.
+struct AeroflyCommandRing {
+    static constexpr uint32_t MAGIC = 0x43434641;   // "AFCC"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t CAPACITY = 1024;              // Power of two
+    static constexpr uint32_t COMPLETION_CAPACITY = 1024;   // Power of two
+
+    uint32_t magic;                 // MAGIC once the mapping is initialized
+    uint32_t version;               // VERSION
+    uint32_t capacity;              // CAPACITY
+    uint32_t cell_size;             // sizeof(AeroflyCommandCell)
+    uint32_t completion_capacity;   // COMPLETION_CAPACITY
+    uint32_t completion_size;       // sizeof(AeroflyCommandCompletion)
+    uint32_t reserved[10];          // Pads the header to 64 bytes
+
+    uint32_t enqueue_position;      // Next cell to claim (producers, atomic)
+    uint32_t producer_padding[15];
+    uint32_t dequeue_position;      // Next cell to drain (bridge only)
+    uint32_t consumer_padding[15];
+    uint32_t completion_count;      // Completions written so far (atomic)
+    uint32_t completion_padding[15];
+
+    AeroflyCommandCell cells[CAPACITY];
+    AeroflyCommandCompletion completions[COMPLETION_CAPACITY];
+
+    // Bridge side, before magic is published
+    void Reset() {
+        for (uint32_t i = 0; i < CAPACITY; i++) {
+            cells[i].sequence = i;
+        }
+    }
+
+    // Client side: false if the ring is full
+    bool TryPush(const AeroflyCommand& command) {
+        std::atomic<uint32_t>& enqueue = SharedAtomic(enqueue_position);
+        uint32_t position = enqueue.load(std::memory_order_relaxed);
+        for (;;) {
+            AeroflyCommandCell& cell = cells[position & (CAPACITY - 1)];
+            const uint32_t sequence = SharedAtomic(cell.sequence).load(std::memory_order_acquire);
+            const int32_t lag = (int32_t)(sequence - position);
+            if (lag == 0) {
+                if (enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    cell.command = command;
+                    SharedAtomic(cell.sequence).store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (lag < 0) {
+                return false;
+            } else {
+                position = enqueue.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Bridge side: false if no published command is waiting
+    bool TryPop(AeroflyCommand& command) {
+        const uint32_t position = dequeue_position;
+        AeroflyCommandCell& cell = cells[position & (CAPACITY - 1)];
+        if (SharedAtomic(cell.sequence).load(std::memory_order_acquire) != position + 1) return false;
+        command = cell.command;
+        SharedAtomic(cell.sequence).store(position + CAPACITY, std::memory_order_release);
+        dequeue_position = position + 1;
+        return true;
+    }
+
+    // Bridge side
+    void Complete(const AeroflyCommand& command, AeroflyCommandStatus status, uint32_t frame) {
+        const uint32_t count = SharedAtomic(completion_count).load(std::memory_order_relaxed);
+        AeroflyCommandCompletion& entry = completions[count & (COMPLETION_CAPACITY - 1)];
+        SharedAtomic(entry.position).store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        entry.client_id = command.client_id;
+        entry.client_sequence = command.client_sequence;
+        entry.status = (uint32_t)status;
+        entry.frame = frame;
+
+        SharedAtomic(entry.position).store(count + 1, std::memory_order_release);
+        SharedAtomic(completion_count).store(count + 1, std::memory_order_release);
+    }
+
+    // Client side: copies completion 'index' (0-based); false if not written yet or already overwritten
+    bool ReadCompletion(uint32_t index, AeroflyCommandCompletion& out) const {
+        const AeroflyCommandCompletion& entry = completions[index & (COMPLETION_CAPACITY - 1)];
+        if (SharedAtomic(entry.position).load(std::memory_order_acquire) != index + 1) return false;
+        memcpy(&out, &entry, sizeof(AeroflyCommandCompletion));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return SharedAtomic(entry.position).load(std::memory_order_relaxed) == index + 1;
+    }
+
+    uint32_t CompletionCount() const {
+        return SharedAtomic(completion_count).load(std::memory_order_acquire);
+    }
+};
+
+static_assert(sizeof(AeroflyCommandCell) == 64, "Command cells are one cache line each");
+static_assert(offsetof(AeroflyCommandRing, enqueue_position) == 64 && offsetof(AeroflyCommandRing, dequeue_position) == 128 &&
+              offsetof(AeroflyCommandRing, completion_count) == 192 && offsetof(AeroflyCommandRing, cells) == 256,
+              "Ring positions live on separate cache lines");
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// FRAME NOTIFICATION - Wake shared-memory readers on each new frame instead of polling
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Wait/wake primitive behind frame notifications. Notify(frame) wakes every waiter of that
+// frame, in any process. Windows backend: two named manual-reset events alternated by frame
+// parity, so frame N sets event N%2 and re-arms the other one for frame N+1.
+class FrameSignal {
+private:
+    HANDLE events[2];
+
+    static void EventName(int parity, char* name, size_t size) {
+        snprintf(name, size, "AeroflyBridgeFrameEvent%d", parity);
+    }
+
+public:
+    FrameSignal() : events{ NULL, NULL } {}
+    ~FrameSignal() { Close(); }
+    FrameSignal(const FrameSignal&) = delete;
+    FrameSignal& operator=(const FrameSignal&) = delete;
+
+    // Writer side
+    bool Create() {
+        for (int parity = 0; parity < 2; parity++) {
+            char name[64];
+            EventName(parity, name, sizeof(name));
+            events[parity] = CreateEventA(NULL, TRUE, FALSE, name);
+            if (events[parity] == NULL) {
+                Close();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Reader side
+    bool Open() {
+        for (int parity = 0; parity < 2; parity++) {
+            char name[64];
+            EventName(parity, name, sizeof(name));
+            events[parity] = OpenEventA(SYNCHRONIZE, FALSE, name);
+            if (events[parity] == NULL) {
+                Close();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void Notify(uint32_t frame) {
+        if (!events[0]) return;
+        ResetEvent(events[(frame + 1) & 1]);
+        SetEvent(events[frame & 1]);
+    }
+
+    // Blocks until 'frame' (or a later frame with the same parity) was notified; false on timeout
+    bool WaitFor(uint32_t frame, DWORD timeout_ms) const {
+        if (!events[0]) return false;
+        return WaitForSingleObject(events[frame & 1], timeout_ms) == WAIT_OBJECT_0;
+    }
+
+    void Close() {
+        for (HANDLE& event : events) {
+            if (event) {
+                CloseHandle(event);
+                event = NULL;
+            }
+        }
+    }
+};
+
+// Reader helper for other processes: block until a newer frame, or until one of the given
+// VariableGroups changed, without spinning on update_counter.
+//   AeroflyFrameWaiter waiter(pData);
+//   uint32_t frame = waiter.WaitForFrame(last_frame, GroupBit(VariableGroup::AUTOPILOT), 1000);
+class AeroflyFrameWaiter {
+private:
+    const AeroflyBridgeData* data;
+    FrameSignal signal;
+    bool opened;
+
+    bool GroupsChangedSince(uint32_t last_frame, uint32_t group_mask) const {
+        const int group_count = (int)(sizeof(data->group_changed_frame) / sizeof(uint32_t));
+        for (int g = 0; g < group_count; g++) {
+            if ((group_mask & (1u << g)) &&
+                SharedAtomic(data->group_changed_frame[g]).load(std::memory_order_acquire) > last_frame) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+public:
+    explicit AeroflyFrameWaiter(const AeroflyBridgeData* shared_data)
+        : data(shared_data), opened(false) {
+        opened = signal.Open();
+    }
+
+    bool IsOpen() const { return opened; }
+
+    // Returns the newest update_counter once it is past last_frame (and, with a group mask,
+    // one of those groups changed after last_frame); 0 on timeout. A wait can take one extra
+    // frame if two frames are published between the counter check and the wait.
+    uint32_t WaitForFrame(uint32_t last_frame, uint32_t group_mask = 0xFFFFFFFF, DWORD timeout_ms = INFINITE) {
+        const ULONGLONG deadline = (timeout_ms == INFINITE) ? 0 : GetTickCount64() + timeout_ms;
+        for (;;) {
+            const uint32_t current = SharedAtomic(data->update_counter).load(std::memory_order_acquire);
+            if (current > last_frame && (group_mask == 0xFFFFFFFF || GroupsChangedSince(last_frame, group_mask))) {
+                return current;
+            }
+
+            DWORD wait_ms = INFINITE;
+            if (timeout_ms != INFINITE) {
+                const ULONGLONG now = GetTickCount64();
+                if (now >= deadline) return 0;
+                wait_ms = (DWORD)(deadline - now);
+            }
+
+            // Without the events (bridge not running yet) fall back to a short sleep
+            if (!opened || !signal.WaitFor(current + 1, wait_ms)) {
+                if (!opened) {
+                    Sleep(1);
+                    opened = signal.Open();
+                } else if (timeout_ms != INFINITE) {
+                    return 0;
+                }
+            }
+        }
+    }
+};
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 // ENHANCED VARIABLE INFO STRUCTURE - Reemplaza TMDParser::VariableInfo
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -770,6 +1290,67 @@ enum class VariableIndex : int {
     VARIABLE_COUNT = 339                           // Total: 339 variables from official SDK
 };
 
+// Variable groups (the VariableIndex ranges above), used for change notification masks
+enum class VariableGroup : int {
+    AIRCRAFT = 0,
+    PERFORMANCE,
+    CONFIGURATION,
+    FLIGHT_MANAGEMENT_SYSTEM,
+    NAVIGATION,
+    COMMUNICATION,
+    AUTOPILOT,
+    FLIGHT_DIRECTOR,
+    COPILOT,
+    CONTROLS,
+    PRESSURIZATION,
+    WARNINGS,
+    VIEW,
+    SIMULATION,
+    COMMAND,
+    SPECIAL,
+    GROUP_COUNT = 16
+};
+
+struct VariableGroupRange {
+    VariableGroup group;
+    int first;                      // First VariableIndex of the group
+    int last;                       // Last VariableIndex of the group (inclusive)
+    const char* name;
+};
+
+static constexpr VariableGroupRange kVariableGroups[] = {
+    { VariableGroup::AIRCRAFT,                   0,  94, "Aircraft" },
+    { VariableGroup::PERFORMANCE,               95, 104, "Performance" },
+    { VariableGroup::CONFIGURATION,            105, 106, "Configuration" },
+    { VariableGroup::FLIGHT_MANAGEMENT_SYSTEM, 107, 107, "FlightManagementSystem" },
+    { VariableGroup::NAVIGATION,               108, 141, "Navigation" },
+    { VariableGroup::COMMUNICATION,            142, 152, "Communication" },
+    { VariableGroup::AUTOPILOT,                153, 180, "Autopilot" },
+    { VariableGroup::FLIGHT_DIRECTOR,          181, 183, "FlightDirector" },
+    { VariableGroup::COPILOT,                  184, 191, "Copilot" },
+    { VariableGroup::CONTROLS,                 192, 260, "Controls" },
+    { VariableGroup::PRESSURIZATION,           261, 262, "Pressurization" },
+    { VariableGroup::WARNINGS,                 263, 272, "Warnings" },
+    { VariableGroup::VIEW,                     273, 302, "View" },
+    { VariableGroup::SIMULATION,               303, 320, "Simulation" },
+    { VariableGroup::COMMAND,                  321, 330, "Command" },
+    { VariableGroup::SPECIAL,                  331, 338, "Special" },
+};
+
+constexpr VariableGroup GroupOfVariable(int index) {
+    for (const VariableGroupRange& range : kVariableGroups) {
+        if (index >= range.first && index <= range.last) return range.group;
+    }
+    return VariableGroup::SPECIAL;
+}
+
+constexpr uint32_t GroupBit(VariableGroup group) {
+    return 1u << (int)group;
+}
+
+static_assert(sizeof(AeroflyBridgeData::group_changed_frame) / sizeof(uint32_t) == (size_t)VariableGroup::GROUP_COUNT,
+              "One change counter per VariableGroup");
+
 
 
 class VariableMapper {
@@ -1521,56 +2102,767 @@ MESSAGE_LIST(TM_MESSAGE)
 
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-// AEROFLY PATH DISCOVERY - Automatic detection of Aerofly FS4 installation
+// MESSAGE DESCRIPTOR TABLE - Generated from MESSAGE_LIST, O(1) hash -> variable decode
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-class AeroflyPathDiscovery {
-    public:
-        static std::string FindAeroflyPath() {
-            std::vector<std::string> candidate_paths = {
-                // Steam common locations
-                "C:\\Program Files (x86)\\Steam\\steamapps\\common\\Aerofly FS 4 Flight Simulator",
-                "C:\\Program Files\\Steam\\steamapps\\common\\Aerofly FS 4 Flight Simulator",
-                "D:\\Steam\\steamapps\\common\\Aerofly FS 4 Flight Simulator",
-                "E:\\Steam\\steamapps\\common\\Aerofly FS 4 Flight Simulator",
-                
-                // Direct installation paths
-                "C:\\Program Files\\Aerofly FS 4 Flight Simulator",
-                "C:\\Program Files (x86)\\Aerofly FS 4 Flight Simulator",
-                "C:\\Aerofly FS 4 Flight Simulator",
-                
-                // Custom Steam library locations
-                "D:\\SteamLibrary\\steamapps\\common\\Aerofly FS 4 Flight Simulator",
-                "E:\\SteamLibrary\\steamapps\\common\\Aerofly FS 4 Flight Simulator",
-                "F:\\SteamLibrary\\steamapps\\common\\Aerofly FS 4 Flight Simulator"
-            };
-            
-            // Check standard paths first
-            for (const auto& path : candidate_paths) {
-                if (std::filesystem::exists(path + "\\aircraft")) {
-                    OutputDebugStringA(("Found Aerofly at: " + path + "\n").c_str());
-                    HybridLogToFile("SUCCESS: Found Aerofly at: " + path);
-                    return path;
+// Named AeroflyFrameData field that mirrors a variable (besides its all_variables[] slot)
+enum class NamedFieldType : uint8_t {
+    None,       // all_variables[] only
+    Double,
+    Vector3d,
+    Uint32,
+    String16    // char[16] (autopilot mode strings)
+};
+
+struct MessageDescriptor {
+    tm_uint64 hash;                  // MessageID on the wire (tm_string_hash of the SDK name)
+    tm_msg_data_type data_type;      // Declared SDK data type
+    tm_msg_flag flag;                // Declared SDK flag (Value, Move, Offset, Toggle...)
+    tm_msg_access access;            // Declared SDK access
+    tm_msg_unit unit;                // Declared SDK unit
+    int variable_index;              // Slot in all_variables[] (== VariableIndex)
+    VariableGroup group;             // Group of variable_index (change notification)
+    NamedFieldType field_type;       // Type of the mirrored named field
+    uint32_t field_offset;           // offsetof() the named field in AeroflyFrameData
+};
+
+struct NamedFieldBinding {
+    VariableIndex index;
+    NamedFieldType type;
+    uint32_t offset;
+};
+
+// Named fields of AeroflyFrameData and the MESSAGE_LIST entry that feeds each one
+#define NAMED_FIELD_LIST(F) \
+F( AIRCRAFT_LATITUDE,                    latitude,                    Double   ) \
+F( AIRCRAFT_LONGITUDE,                   longitude,                   Double   ) \
+F( AIRCRAFT_ALTITUDE,                    altitude,                    Double   ) \
+F( AIRCRAFT_PITCH,                       pitch,                       Double   ) \
+F( AIRCRAFT_BANK,                        bank,                        Double   ) \
+F( AIRCRAFT_TRUE_HEADING,                true_heading,                Double   ) \
+F( AIRCRAFT_MAGNETIC_HEADING,            magnetic_heading,            Double   ) \
+F( AIRCRAFT_INDICATED_AIRSPEED,          indicated_airspeed,          Double   ) \
+F( AIRCRAFT_GROUND_SPEED,                ground_speed,                Double   ) \
+F( AIRCRAFT_VERTICAL_SPEED,              vertical_speed,              Double   ) \
+F( AIRCRAFT_ANGLE_OF_ATTACK,             angle_of_attack,             Double   ) \
+F( AIRCRAFT_ANGLE_OF_ATTACK_LIMIT,       angle_of_attack_limit,       Double   ) \
+F( AIRCRAFT_MACH_NUMBER,                 mach_number,                 Double   ) \
+F( AIRCRAFT_RATE_OF_TURN,                rate_of_turn,                Double   ) \
+F( AIRCRAFT_POSITION,                    position,                    Vector3d ) \
+F( AIRCRAFT_VELOCITY,                    velocity,                    Vector3d ) \
+F( AIRCRAFT_ACCELERATION,                acceleration,                Vector3d ) \
+F( AIRCRAFT_ANGULAR_VELOCITY,            angular_velocity,            Vector3d ) \
+F( AIRCRAFT_WIND,                        wind,                        Vector3d ) \
+F( AIRCRAFT_GRAVITY,                     gravity,                     Vector3d ) \
+F( AIRCRAFT_ON_GROUND,                   on_ground,                   Double   ) \
+F( AIRCRAFT_ON_RUNWAY,                   on_runway,                   Double   ) \
+F( AIRCRAFT_CRASHED,                     crashed,                     Double   ) \
+F( AIRCRAFT_GEAR,                        gear_position,               Double   ) \
+F( AIRCRAFT_FLAPS,                       flaps_position,              Double   ) \
+F( AIRCRAFT_SLATS,                       slats_position,              Double   ) \
+F( AIRCRAFT_THROTTLE,                    throttle_position,           Double   ) \
+F( AIRCRAFT_AIR_BRAKE,                   airbrake_position,           Double   ) \
+F( AIRCRAFT_ENGINE_THROTTLE_1,           engine_throttle[0],          Double   ) \
+F( AIRCRAFT_ENGINE_THROTTLE_2,           engine_throttle[1],          Double   ) \
+F( AIRCRAFT_ENGINE_THROTTLE_3,           engine_throttle[2],          Double   ) \
+F( AIRCRAFT_ENGINE_THROTTLE_4,           engine_throttle[3],          Double   ) \
+F( AIRCRAFT_ENGINE_ROTATION_SPEED_1,     engine_rotation_speed[0],    Double   ) \
+F( AIRCRAFT_ENGINE_ROTATION_SPEED_2,     engine_rotation_speed[1],    Double   ) \
+F( AIRCRAFT_ENGINE_ROTATION_SPEED_3,     engine_rotation_speed[2],    Double   ) \
+F( AIRCRAFT_ENGINE_ROTATION_SPEED_4,     engine_rotation_speed[3],    Double   ) \
+F( AIRCRAFT_ENGINE_RUNNING_1,            engine_running[0],           Double   ) \
+F( AIRCRAFT_ENGINE_RUNNING_2,            engine_running[1],           Double   ) \
+F( AIRCRAFT_ENGINE_RUNNING_3,            engine_running[2],           Double   ) \
+F( AIRCRAFT_ENGINE_RUNNING_4,            engine_running[3],           Double   ) \
+F( CONTROLS_PITCH_INPUT,                 pitch_input,                 Double   ) \
+F( CONTROLS_ROLL_INPUT,                  roll_input,                  Double   ) \
+F( CONTROLS_YAW_INPUT,                   yaw_input,                   Double   ) \
+F( COMMUNICATION_COM1_FREQUENCY,         com1_frequency,              Double   ) \
+F( COMMUNICATION_COM1_STANDBY_FREQUENCY, com1_standby_frequency,      Double   ) \
+F( COMMUNICATION_COM2_FREQUENCY,         com2_frequency,              Double   ) \
+F( COMMUNICATION_COM2_STANDBY_FREQUENCY, com2_standby_frequency,      Double   ) \
+F( NAVIGATION_NAV1_FREQUENCY,            nav1_frequency,              Double   ) \
+F( NAVIGATION_NAV1_STANDBY_FREQUENCY,    nav1_standby_frequency,      Double   ) \
+F( NAVIGATION_SELECTED_COURSE_1,         nav1_selected_course,        Double   ) \
+F( NAVIGATION_NAV2_FREQUENCY,            nav2_frequency,              Double   ) \
+F( NAVIGATION_NAV2_STANDBY_FREQUENCY,    nav2_standby_frequency,      Double   ) \
+F( NAVIGATION_SELECTED_COURSE_2,         nav2_selected_course,        Double   ) \
+F( AUTOPILOT_ENGAGED,                    ap_engaged,                  Double   ) \
+F( AUTOPILOT_SELECTED_AIRSPEED,          ap_selected_airspeed,        Double   ) \
+F( AUTOPILOT_SELECTED_HEADING,           ap_selected_heading,         Double   ) \
+F( AUTOPILOT_SELECTED_ALTITUDE,          ap_selected_altitude,        Double   ) \
+F( AUTOPILOT_SELECTED_VERTICAL_SPEED,    ap_selected_vs,              Double   ) \
+F( AUTOPILOT_THROTTLE_ENGAGED,           ap_throttle_engaged,         Double   ) \
+F( AUTOPILOT_ACTIVE_LATERAL_MODE,        ap_lateral_mode,             String16 ) \
+F( AUTOPILOT_ACTIVE_VERTICAL_MODE,       ap_vertical_mode,            String16 ) \
+F( PERFORMANCE_SPEED_VS0,                vs0_speed,                   Double   ) \
+F( PERFORMANCE_SPEED_VS1,                vs1_speed,                   Double   ) \
+F( PERFORMANCE_SPEED_VFE,                vfe_speed,                   Double   ) \
+F( PERFORMANCE_SPEED_VNO,                vno_speed,                   Double   ) \
+F( PERFORMANCE_SPEED_VNE,                vne_speed,                   Double   ) \
+F( WARNINGS_MASTER_WARNING,              master_warning,              Uint32   ) \
+F( WARNINGS_MASTER_CAUTION,              master_caution,              Uint32   )
+
+#define TM_NAMED_FIELD( index, field, type )    NamedFieldBinding{ VariableIndex::index, NamedFieldType::type, (uint32_t)offsetof( AeroflyFrameData, field ) },
+#define TM_DESCRIPTOR( a1, a2, a3, a4, a5, a6, a7 )    MessageDescriptor{ tm_string_hash( a2 ).GetHash(), a3, a4, a5, a6, 0, VariableGroup::SPECIAL, NamedFieldType::None, 0 },
+
+static constexpr NamedFieldBinding kNamedFieldBindings[] = { NAMED_FIELD_LIST(TM_NAMED_FIELD) };
+
+static_assert(sizeof(tm_vector3d) == 3 * sizeof(double), "tm_vector3d must be three packed doubles");
+static_assert(sizeof(AeroflyFrameData::ap_lateral_mode) == 16 && sizeof(AeroflyFrameData::ap_vertical_mode) == 16,
+              "String16 named fields must be char[16]");
+
+// Descriptor per MESSAGE_LIST entry plus an open-addressing hash index, all built at compile time.
+// Duplicate names (Value/Move/Offset variants) resolve to the first entry, which is the Value one.
+class MessageDescriptorTable {
+public:
+    static constexpr int kCount = (int)VariableIndex::VARIABLE_COUNT;
+    static constexpr uint32_t kSlots = 1024;    // Power of two, load factor < 0.35
+
+private:
+    MessageDescriptor descriptors[kCount];
+    int16_t slots[kSlots];
+
+    static constexpr uint32_t SlotOf(tm_uint64 hash) {
+        return (uint32_t)(hash ^ (hash >> 32)) & (kSlots - 1);
+    }
+
+public:
+    constexpr MessageDescriptorTable() : descriptors{ MESSAGE_LIST(TM_DESCRIPTOR) }, slots{} {
+        for (uint32_t s = 0; s < kSlots; s++) {
+            slots[s] = -1;
+        }
+
+        // One pass over the bindings keeps the constant evaluation well inside compiler step limits
+        for (const NamedFieldBinding& binding : kNamedFieldBindings) {
+            descriptors[(int)binding.index].field_type = binding.type;
+            descriptors[(int)binding.index].field_offset = binding.offset;
+        }
+
+        for (int i = 0; i < kCount; i++) {
+            MessageDescriptor& d = descriptors[i];
+            d.variable_index = i;
+            d.group = GroupOfVariable(i);
+
+            if (d.data_type == tm_msg_data_type::None) continue;    // Binary datablocks, never decoded
+
+            uint32_t slot = SlotOf(d.hash);
+            bool duplicate = false;
+            while (slots[slot] >= 0) {
+                if (descriptors[slots[slot]].hash == d.hash) {
+                    duplicate = true;
+                    break;
                 }
-                // Log attempted paths for debugging
-                HybridLogToFile("Checked path (not found): " + path);
+                slot = (slot + 1) & (kSlots - 1);
             }
-            
-            // Try registry-based discovery for Steam
-            std::string steam_path = GetSteamPathFromRegistry();
-            if (!steam_path.empty()) {
-                std::string aerofly_path = steam_path + "\\steamapps\\common\\Aerofly FS 4 Flight Simulator";
-                if (std::filesystem::exists(aerofly_path + "\\aircraft")) {
-                    OutputDebugStringA(("Found Aerofly via Steam registry: " + aerofly_path + "\n").c_str());
-                    return aerofly_path;
-                }
+            if (!duplicate) {
+                slots[slot] = (int16_t)i;
             }
-            
-            OutputDebugStringA("WARNING: Aerofly FS 4 installation not found\n");
-            return "";
         }
-        
-    private:
+    }
+
+    constexpr const MessageDescriptor* Find(tm_uint64 hash) const {
+        uint32_t slot = SlotOf(hash);
+        while (slots[slot] >= 0) {
+            const MessageDescriptor& d = descriptors[slots[slot]];
+            if (d.hash == hash) return &d;
+            slot = (slot + 1) & (kSlots - 1);
+        }
+        return nullptr;
+    }
+
+    constexpr const MessageDescriptor& operator[](int index) const { return descriptors[index]; }
+};
+
+static constexpr MessageDescriptorTable kMessageTable{};
+
+static_assert(kMessageTable[(int)VariableIndex::AIRCRAFT_LATITUDE].hash == tm_string_hash("Aircraft.Latitude").GetHash(),
+              "MESSAGE_LIST order must match VariableIndex");
+static_assert(kMessageTable[(int)VariableIndex::ILS2_DATA].hash == tm_string_hash("Navigation.ILS2Data").GetHash(),
+              "MESSAGE_LIST order must match VariableIndex");
+static_assert(kMessageTable.Find(tm_string_hash("Controls.Throttle1").GetHash())->flag == tm_msg_flag::Value,
+              "Duplicate names must resolve to the Value entry");
+
+// tm_string_hash of a name known only at runtime (FNV-1a, folding in the terminating null like
+// tm_string_hasher does)
+constexpr tm_uint64 MessageNameHash(std::string_view name) {
+    tm_uint64 hash = 14695981039346656037ull;
+    for (char c : name) {
+        hash = (hash ^ static_cast<tm_uint64>(c)) * 1099511628211ull;
+    }
+    return hash * 1099511628211ull;
+}
+
+static_assert(MessageNameHash("Controls.Throttle") == tm_string_hash("Controls.Throttle").GetHash(),
+              "MessageNameHash must match tm_string_hash");
+
+// Variable handles, resolved once by name on the command port: a VariableIndex for core variables,
+// kDynamicHandleFlag | slot for a discovered variable's dynamic_values slot. Stable for a session.
+constexpr uint32_t kDynamicHandleFlag = 0x80000000u;
+constexpr uint32_t kInvalidHandle = 0xFFFFFFFFu;
+
+// Command routing: every writable Double variable of MESSAGE_LIST, keyed by name hash through a
+// perfect hash found at compile time (a multiplier that maps the names to distinct slots), so a
+// lookup is one multiply, one load and one hash compare whatever the name.
+struct CommandRoute {
+    static constexpr int kMaxVariants = 3;
+    
+    tm_uint64 hash;
+    int16_t entries[kMaxVariants];      // MESSAGE_LIST entries sharing the name (Value first), -1 = unused
+};
+
+class CommandRouteTable {
+public:
+    static constexpr int kMaxRoutes = 256;
+    static constexpr uint32_t kSlotBits = 12;
+    static constexpr uint32_t kSlots = 1u << kSlotBits;    // 4096 slots for ~150 names
+    
+private:
+    CommandRoute routes[kMaxRoutes];
+    int route_count;
+    int16_t slots[kSlots];
+    tm_uint64 multiplier;               // 0 if no perfect multiplier was found
+    
+    constexpr uint32_t SlotOf(tm_uint64 hash) const {
+        return (uint32_t)((hash * multiplier) >> (64 - kSlotBits));
+    }
+    
+public:
+    constexpr CommandRouteTable() : routes{}, route_count(0), slots{}, multiplier(0) {
+        for (int i = 0; i < MessageDescriptorTable::kCount; i++) {
+            const MessageDescriptor& d = kMessageTable[i];
+            if (d.data_type != tm_msg_data_type::Double ||
+                (d.access != tm_msg_access::Write && d.access != tm_msg_access::ReadWrite)) continue;
+            
+            int r = 0;
+            while (r < route_count && routes[r].hash != d.hash) r++;
+            if (r == route_count) {
+                if (route_count == kMaxRoutes) continue;
+                routes[r].hash = d.hash;
+                for (int16_t& entry : routes[r].entries) entry = -1;
+                route_count++;
+            }
+            for (int16_t& entry : routes[r].entries) {
+                if (entry < 0) {
+                    entry = (int16_t)i;
+                    break;
+                }
+            }
+        }
+        
+        // Odd multipliers from a Weyl sequence until every name lands in its own slot
+        for (tm_uint64 candidate = 0x9E3779B97F4A7C15ull; multiplier == 0; candidate += 0x6A09E667F3BCC908ull) {
+            multiplier = candidate | 1;
+            uint64_t used[kSlots / 64] = {};
+            for (int r = 0; r < route_count; r++) {
+                const uint32_t slot = SlotOf(routes[r].hash);
+                if (used[slot / 64] & (1ull << (slot % 64))) {
+                    multiplier = 0;
+                    break;
+                }
+                used[slot / 64] |= 1ull << (slot % 64);
+            }
+        }
+        for (uint32_t slot = 0; slot < kSlots; slot++) {
+            slots[slot] = -1;
+        }
+        for (int r = 0; r < route_count; r++) {
+            slots[SlotOf(routes[r].hash)] = (int16_t)r;
+        }
+    }
+    
+    constexpr const CommandRoute* Find(tm_uint64 hash) const {
+        const int16_t r = slots[SlotOf(hash)];
+        return r >= 0 && routes[r].hash == hash ? &routes[r] : nullptr;
+    }
+    
+    constexpr int Count() const { return route_count; }
+};
+
+static constexpr CommandRouteTable kCommandRoutes{};
+
+static_assert(kCommandRoutes.Count() < CommandRouteTable::kMaxRoutes, "Raise CommandRouteTable::kMaxRoutes");
+static_assert(kCommandRoutes.Find(tm_string_hash("Autopilot.SelectedVerticalSpeed").GetHash())->hash ==
+              tm_string_hash("Autopilot.SelectedVerticalSpeed").GetHash(),
+              "Writable variables must be routed");
+static_assert(kCommandRoutes.Find(tm_string_hash("Aircraft.Altitude").GetHash()) == nullptr, "Read-only variables are not routed");
+static_assert(kMessageTable[kCommandRoutes.Find(tm_string_hash("Controls.Trim").GetHash())->entries[1]].flag == tm_msg_flag::Step,
+              "Routes keep every flag variant of a name");
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// SHARED MEMORY SCHEMA - "AeroflyBridgeSchema" mapping
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Self-description of the AeroflyBridgeData layout, generated at compile time from the struct
+// and MESSAGE_LIST. Clients resolve offsets by name once at attach time instead of hardcoding them.
+// Offsets below frame_size also apply to each frame in "AeroflyBridgeFrames".
+
+enum class SchemaFieldType : uint16_t {
+    None,
+    Double,
+    Uint16,
+    Uint32,
+    Uint64,
+    Vector3d,   // Three doubles (x, y, z)
+    Char,       // Null-terminated 8-bit text, count = capacity in bytes
+    Struct      // Array of records documented next to AeroflyBridgeData, size / count bytes each
+};
+
+struct AeroflySchemaEntry {
+    char name[64];                  // Field name ("latitude") or SDK name of an all_variables slot ("Aircraft.Altitude")
+    uint32_t offset;                // Byte offset in the "AeroflyBridgeData" mapping
+    uint32_t size;                  // Total size in bytes
+    uint16_t type;                  // SchemaFieldType
+    uint16_t count;                 // Number of elements (1 for scalars)
+    uint16_t unit;                  // tm_msg_unit of the SDK variable, None otherwise
+    uint16_t data_type;             // tm_msg_data_type of the SDK variable, None otherwise
+    uint16_t variable_index;        // VariableIndex of the SDK variable, NO_VARIABLE otherwise
+    uint16_t reserved[7];           // Pads the entry to 96 bytes
+
+    static constexpr uint16_t NO_VARIABLE = 0xFFFF;
+};
+
+static_assert(sizeof(AeroflySchemaEntry) == 96, "Schema entries are 96 bytes");
+
+// Every field of AeroflyBridgeData in layout order (reserved words are left out).
+// all_variables is listed as a whole here and once per slot from MESSAGE_LIST.
+#define BRIDGE_FIELD_LIST(F) \
+F( timestamp_us,                Uint64   ) \
+F( data_valid,                  Uint32   ) \
+F( update_counter,              Uint32   ) \
+F( frame_sequence,              Uint32   ) \
+F( layout_version,              Uint32   ) \
+F( changed_count,               Uint32   ) \
+F( changed_bitmap,              Uint32   ) \
+F( changed_indices,             Uint16   ) \
+F( latitude,                    Double   ) \
+F( longitude,                   Double   ) \
+F( altitude,                    Double   ) \
+F( pitch,                       Double   ) \
+F( bank,                        Double   ) \
+F( true_heading,                Double   ) \
+F( magnetic_heading,            Double   ) \
+F( indicated_airspeed,          Double   ) \
+F( ground_speed,                Double   ) \
+F( vertical_speed,              Double   ) \
+F( angle_of_attack,             Double   ) \
+F( angle_of_attack_limit,       Double   ) \
+F( mach_number,                 Double   ) \
+F( rate_of_turn,                Double   ) \
+F( position,                    Vector3d ) \
+F( velocity,                    Vector3d ) \
+F( acceleration,                Vector3d ) \
+F( angular_velocity,            Vector3d ) \
+F( wind,                        Vector3d ) \
+F( gravity,                     Vector3d ) \
+F( pitch_input,                 Double   ) \
+F( roll_input,                  Double   ) \
+F( yaw_input,                   Double   ) \
+F( throttle_position,           Double   ) \
+F( engine_throttle,             Double   ) \
+F( engine_rotation_speed,       Double   ) \
+F( on_ground,                   Double   ) \
+F( on_runway,                   Double   ) \
+F( crashed,                     Double   ) \
+F( gear_position,               Double   ) \
+F( flaps_position,              Double   ) \
+F( slats_position,              Double   ) \
+F( airbrake_position,           Double   ) \
+F( engine_running,              Double   ) \
+F( warning_flags,               Uint32   ) \
+F( master_warning,              Uint32   ) \
+F( master_caution,              Uint32   ) \
+F( com1_frequency,              Double   ) \
+F( com1_standby_frequency,      Double   ) \
+F( com2_frequency,              Double   ) \
+F( com2_standby_frequency,      Double   ) \
+F( nav1_frequency,              Double   ) \
+F( nav1_standby_frequency,      Double   ) \
+F( nav1_selected_course,        Double   ) \
+F( nav2_frequency,              Double   ) \
+F( nav2_standby_frequency,      Double   ) \
+F( nav2_selected_course,        Double   ) \
+F( ap_engaged,                  Double   ) \
+F( ap_selected_airspeed,        Double   ) \
+F( ap_selected_heading,         Double   ) \
+F( ap_selected_altitude,        Double   ) \
+F( ap_selected_vs,              Double   ) \
+F( ap_throttle_engaged,         Double   ) \
+F( ap_lateral_mode,             Char     ) \
+F( ap_vertical_mode,            Char     ) \
+F( vs0_speed,                   Double   ) \
+F( vs1_speed,                   Double   ) \
+F( vfe_speed,                   Double   ) \
+F( vno_speed,                   Double   ) \
+F( vne_speed,                   Double   ) \
+F( all_variables,               Double   ) \
+F( group_changed_frame,         Uint32   ) \
+F( dynamic_changed_count,       Uint32   ) \
+F( dynamic_changed_bitmap,      Uint32   ) \
+F( dynamic_values,              Double   ) \
+F( dynamic_count,               Uint32   ) \
+F( dynamic_capacity,            Uint32   ) \
+F( dynamic_lookup,              Struct   ) \
+F( categories,                  Struct   ) \
+F( category_count,              Uint32   ) \
+F( aircraft,                    Struct   ) \
+F( aircraft_count,              Uint32   ) \
+F( dynamic_buckets,             Uint16   ) \
+F( hybrid_core_variables,       Uint32   ) \
+F( hybrid_dynamic_variables,    Uint32   ) \
+F( hybrid_discovered_variables, Uint32   ) \
+F( hybrid_discovery_complete,   Uint32   ) \
+F( aerofly_path,                Char     )
+
+struct SchemaFieldInfo {
+    const char* name;
+    uint32_t offset;
+    uint32_t size;
+    uint32_t count;
+    SchemaFieldType type;
+};
+
+#define TM_SCHEMA_FIELD( field, type )    SchemaFieldInfo{ #field, (uint32_t)offsetof( AeroflyBridgeData, field ), (uint32_t)sizeof( AeroflyBridgeData::field ), \
+                                                           (uint32_t)( std::extent<decltype( AeroflyBridgeData::field )>::value ? std::extent<decltype( AeroflyBridgeData::field )>::value : 1 ), \
+                                                           SchemaFieldType::type },
+#define TM_SCHEMA_NAME( a1, a2, a3, a4, a5, a6, a7 )    a2,
+
+static constexpr SchemaFieldInfo kBridgeFields[] = { BRIDGE_FIELD_LIST(TM_SCHEMA_FIELD) };
+static constexpr const char* kMessageNames[] = { MESSAGE_LIST(TM_SCHEMA_NAME) };
+
+struct AeroflyBridgeSchema {
+    static constexpr uint32_t MAGIC = 0x43534641;   // "AFSC"
+    static constexpr uint32_t VERSION = 1;          // Format of this block (not of AeroflyBridgeData)
+    static constexpr uint32_t FIELD_COUNT = (uint32_t)(sizeof(kBridgeFields) / sizeof(kBridgeFields[0]));
+    static constexpr uint32_t ENTRY_COUNT = FIELD_COUNT + (uint32_t)VariableIndex::VARIABLE_COUNT;
+
+    uint32_t magic;                 // MAGIC once the mapping is initialized
+    uint32_t version;               // VERSION
+    uint32_t layout_version;        // AeroflyBridgeData::LAYOUT_VERSION
+    uint32_t data_size;             // sizeof(AeroflyBridgeData)
+    uint32_t frame_size;            // sizeof(AeroflyFrameData), the part copied into frame slots
+    uint32_t entry_count;           // ENTRY_COUNT: FIELD_COUNT fields, then one entry per all_variables slot
+    uint32_t entry_size;            // sizeof(AeroflySchemaEntry)
+    uint32_t field_count;           // FIELD_COUNT
+    uint32_t reserved[8];           // Pads the header to 64 bytes
+
+    AeroflySchemaEntry entries[ENTRY_COUNT];
+
+    constexpr AeroflyBridgeSchema()
+        : magic(MAGIC), version(VERSION), layout_version(AeroflyBridgeData::LAYOUT_VERSION),
+          data_size((uint32_t)sizeof(AeroflyBridgeData)), frame_size((uint32_t)sizeof(AeroflyFrameData)),
+          entry_count(ENTRY_COUNT), entry_size((uint32_t)sizeof(AeroflySchemaEntry)), field_count(FIELD_COUNT),
+          reserved{}, entries{} {
+        for (uint32_t i = 0; i < FIELD_COUNT; i++) {
+            const SchemaFieldInfo& field = kBridgeFields[i];
+            AeroflySchemaEntry& e = entries[i];
+            SetEntry(e, field.name, field.offset, field.size, field.type, field.count);
+        }
+
+        // Named fields mirror an SDK variable; arrays (engine_throttle...) take the unit of their first element
+        for (const NamedFieldBinding& binding : kNamedFieldBindings) {
+            const uint32_t i = FieldAtOffset(binding.offset);
+            if (i == FIELD_COUNT) continue;
+            const SchemaFieldInfo& field = kBridgeFields[i];
+            const MessageDescriptor& d = kMessageTable[(int)binding.index];
+            AeroflySchemaEntry& e = entries[i];
+            e.unit = (uint16_t)d.unit;
+            e.data_type = (uint16_t)d.data_type;
+            if (field.count == 1 || field.type == SchemaFieldType::Char) {
+                e.variable_index = (uint16_t)binding.index;
+            }
+        }
+
+        for (int i = 0; i < MessageDescriptorTable::kCount; i++) {
+            const MessageDescriptor& d = kMessageTable[i];
+            AeroflySchemaEntry& e = entries[FIELD_COUNT + i];
+            SetEntry(e, kMessageNames[i], (uint32_t)(offsetof(AeroflyFrameData, all_variables) + i * sizeof(double)),
+                     (uint32_t)sizeof(double), SchemaFieldType::Double, 1);
+            e.unit = (uint16_t)d.unit;
+            e.data_type = (uint16_t)d.data_type;
+            e.variable_index = (uint16_t)i;
+        }
+    }
+
+    // Binary search, kBridgeFields is in offset order; FIELD_COUNT if no field starts there
+    static constexpr uint32_t FieldAtOffset(uint32_t offset) {
+        uint32_t low = 0;
+        uint32_t high = FIELD_COUNT;
+        while (low < high) {
+            const uint32_t mid = (low + high) / 2;
+            if (kBridgeFields[mid].offset < offset) low = mid + 1;
+            else high = mid;
+        }
+        return low < FIELD_COUNT && kBridgeFields[low].offset == offset ? low : FIELD_COUNT;
+    }
+
+    static constexpr bool FieldsInOffsetOrder() {
+        for (uint32_t i = 1; i < FIELD_COUNT; i++) {
+            if (kBridgeFields[i].offset <= kBridgeFields[i - 1].offset) return false;
+        }
+        return true;
+    }
+
+private:
+    static constexpr void SetEntry(AeroflySchemaEntry& e, const char* name, uint32_t offset, uint32_t size,
+                                   SchemaFieldType type, uint32_t count) {
+        uint32_t n = 0;
+        for (; name[n] != '\0' && n + 1 < sizeof(e.name); n++) {
+            e.name[n] = name[n];
+        }
+        e.name[n] = '\0';
+        e.offset = offset;
+        e.size = size;
+        e.type = (uint16_t)type;
+        e.count = (uint16_t)count;
+        e.unit = (uint16_t)tm_msg_unit::None;
+        e.data_type = (uint16_t)tm_msg_data_type::None;
+        e.variable_index = AeroflySchemaEntry::NO_VARIABLE;
+    }
+};
+
+static_assert(AeroflyBridgeSchema::FieldsInOffsetOrder(), "BRIDGE_FIELD_LIST must list fields in offset order");
+static constexpr AeroflyBridgeSchema kBridgeSchema{};
+
+static_assert(offsetof(AeroflyBridgeSchema, entries) == 64, "Schema entries start after a 64-byte header");
+static_assert(sizeof(kMessageNames) / sizeof(kMessageNames[0]) == (size_t)MessageDescriptorTable::kCount,
+              "One schema name per MESSAGE_LIST entry");
+static_assert(kBridgeSchema.entries[AeroflyBridgeSchema::FIELD_COUNT - 1].offset +
+              kBridgeSchema.entries[AeroflyBridgeSchema::FIELD_COUNT - 1].size <= sizeof(AeroflyBridgeData),
+              "BRIDGE_FIELD_LIST must stay inside AeroflyBridgeData");
+
+// Copies an SDK string payload (UTF-16 String or 8-bit String8) into a fixed char field
+static void CopyMessageString(tm_msg_data_type wire_type, const tm_uint8* payload, tm_uint32 payload_size,
+                              char* out, size_t out_size) {
+    const size_t max_chars = payload_size /
+        (wire_type == tm_msg_data_type::String ? sizeof(tm_chartype) : sizeof(char));
+    size_t n = 0;
+    for (; n + 1 < out_size && n < max_chars; n++) {
+        char c;
+        if (wire_type == tm_msg_data_type::String) {
+            tm_chartype wc;
+            memcpy(&wc, payload + n * sizeof(tm_chartype), sizeof(wc));
+            c = (wc < 0x80) ? (char)wc : '?';
+        } else {
+            c = (char)payload[n];
+        }
+        if (c == '\0') break;
+        out[n] = c;
+    }
+    out[n] = '\0';
+}
+
+// Reads a Double/Int/Float payload as double; false for any other type or a truncated payload
+static bool DecodeScalarValue(tm_msg_data_type wire_type, const tm_uint8* payload, tm_uint32 payload_size, double& value) {
+    switch (wire_type) {
+        case tm_msg_data_type::Double:
+            if (payload_size < sizeof(double)) return false;
+            memcpy(&value, payload, sizeof(value));
+            return true;
+        case tm_msg_data_type::Int: {
+            tm_int64 v;
+            if (payload_size < sizeof(v)) return false;
+            memcpy(&v, payload, sizeof(v));
+            value = (double)v;
+            return true;
+        }
+        case tm_msg_data_type::Float: {
+            float v;
+            if (payload_size < sizeof(v)) return false;
+            memcpy(&v, payload, sizeof(v));
+            value = v;
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+// Decodes one message payload into all_variables[] and its named field (if any).
+// Switches on the wire data type so a message sent with an unexpected type is skipped
+// instead of tripping the SDK getter asserts. Returns true if the stored value changed.
+static bool DecodeMessageValue(const MessageDescriptor& d, tm_msg_data_type wire_type,
+                               const tm_uint8* payload, tm_uint32 payload_size, AeroflyFrameData& data) {
+    uint8_t* field = reinterpret_cast<uint8_t*>(&data) + d.field_offset;
+    const bool is_string = (wire_type == tm_msg_data_type::String || wire_type == tm_msg_data_type::String8);
+    if (!is_string && payload_size < (tm_uint32)tm_msg_data_type_size(wire_type)) return false;    // Truncated payload
+    bool changed = false;
+
+    switch (wire_type) {
+        case tm_msg_data_type::Double:
+        case tm_msg_data_type::Int:
+        case tm_msg_data_type::Float: {
+            double value;
+            DecodeScalarValue(wire_type, payload, payload_size, value);
+
+            changed = memcmp(&data.all_variables[d.variable_index], &value, sizeof(value)) != 0;
+            if (!changed) break;    // Unchanged values are not rewritten, so their cache lines stay clean
+            data.all_variables[d.variable_index] = value;
+            if (d.field_type == NamedFieldType::Double) {
+                memcpy(field, &value, sizeof(value));
+            } else if (d.field_type == NamedFieldType::Uint32) {
+                const uint32_t flag_value = (std::isfinite(value) && value > 0.0) ? (uint32_t)value : 0;
+                memcpy(field, &flag_value, sizeof(flag_value));
+            }
+            break;
+        }
+
+        case tm_msg_data_type::Vector3d:
+            if (d.field_type == NamedFieldType::Vector3d) {
+                changed = memcmp(field, payload, sizeof(tm_vector3d)) != 0;
+                if (changed) memcpy(field, payload, sizeof(tm_vector3d));
+            }
+            break;
+
+        case tm_msg_data_type::String:
+        case tm_msg_data_type::String8:
+            if (d.field_type == NamedFieldType::String16) {
+                char text[16];
+                CopyMessageString(wire_type, payload, payload_size, text, sizeof(text));
+                changed = strncmp(reinterpret_cast<char*>(field), text, sizeof(text)) != 0;
+                if (changed) memcpy(field, text, sizeof(text));
+            }
+            break;
+
+        default:
+            // Vector2d/Vector4d/binary blocks have no storage in AeroflyFrameData
+            break;
+    }
+    return changed;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// MESSAGE STREAM VIEW - Zero-copy iteration over the simulator's received byte stream
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// One message inside the byte stream: header loaded with memcpy, payload left in place
+struct MessageView {
+    tm_msg_header header;
+    const tm_uint8* payload;         // Points into the simulator's buffer (valid during the Update call)
+    tm_uint32 payload_size;
+
+    tm_uint64 GetID() const { return header.MessageID; }
+    tm_msg_data_type GetDataType() const { return header.DataType; }
+};
+
+// Walks message_list_received_byte_stream in place instead of copying every message
+// into a tm_external_message. Stops early on a truncated or malformed message.
+class MessageStreamView {
+public:
+    class Iterator {
+    private:
+        const tm_uint8* data;
+        tm_uint32 size;
+        tm_uint32 pos;
+        tm_uint32 remaining;
+        MessageView current;
+
+        void Load() {
+            constexpr tm_uint32 header_size = (tm_uint32)sizeof(tm_msg_header);
+            if (remaining == 0 || pos > size || size - pos < header_size) {
+                remaining = 0;
+                return;
+            }
+
+            memcpy(&current.header, data + pos, header_size);
+            if (current.header.MessageSize < header_size || current.header.MessageSize > size - pos) {
+                remaining = 0;
+                return;
+            }
+
+            current.payload = data + pos + header_size;
+            current.payload_size = current.header.MessageSize - header_size;
+            if (current.payload_size > tm_external_message::GetMaxDataSize()) {
+                current.payload_size = tm_external_message::GetMaxDataSize();
+            }
+        }
+
+    public:
+        Iterator() : data(nullptr), size(0), pos(0), remaining(0), current{} {}
+        Iterator(const tm_uint8* stream, tm_uint32 stream_size, tm_uint32 count)
+            : data(stream), size(stream_size), pos(0), remaining(stream ? count : 0), current{} {
+            Load();
+        }
+
+        const MessageView& operator*() const { return current; }
+        const MessageView* operator->() const { return &current; }
+
+        Iterator& operator++() {
+            pos += current.header.MessageSize;
+            remaining--;
+            Load();
+            return *this;
+        }
+
+        bool operator==(const Iterator& other) const { return remaining == other.remaining; }
+        bool operator!=(const Iterator& other) const { return remaining != other.remaining; }
+    };
+
+    MessageStreamView(const tm_uint8* stream, tm_uint32 stream_size, tm_uint32 message_count)
+        : data(stream), size(stream_size), count(message_count) {}
+
+    Iterator begin() const { return Iterator(data, size, count); }
+    Iterator end() const { return Iterator(); }
+    tm_uint32 GetMessageCount() const { return count; }
+
+private:
+    const tm_uint8* data;
+    tm_uint32 size;
+    tm_uint32 count;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// AEROFLY PATH DISCOVERY - Automatic detection of Aerofly FS4 installation
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+class AeroflyPathDiscovery {
+    public:
+        static std::string FindAeroflyPath() {
+            std::vector<std::string> candidate_paths = {
+                // Steam common locations
+                "C:\\Program Files (x86)\\Steam\\steamapps\\common\\Aerofly FS 4 Flight Simulator",
+                "C:\\Program Files\\Steam\\steamapps\\common\\Aerofly FS 4 Flight Simulator",
+                "D:\\Steam\\steamapps\\common\\Aerofly FS 4 Flight Simulator",
+                "E:\\Steam\\steamapps\\common\\Aerofly FS 4 Flight Simulator",
+                
+                // Direct installation paths
+                "C:\\Program Files\\Aerofly FS 4 Flight Simulator",
+                "C:\\Program Files (x86)\\Aerofly FS 4 Flight Simulator",
+                "C:\\Aerofly FS 4 Flight Simulator",
+                
+                // Custom Steam library locations
+                "D:\\SteamLibrary\\steamapps\\common\\Aerofly FS 4 Flight Simulator",
+                "E:\\SteamLibrary\\steamapps\\common\\Aerofly FS 4 Flight Simulator",
+                "F:\\SteamLibrary\\steamapps\\common\\Aerofly FS 4 Flight Simulator"
+            };
+            
+            // Check standard paths first
+            for (const auto& path : candidate_paths) {
+                if (std::filesystem::exists(path + "\\aircraft")) {
+                    OutputDebugStringA(("Found Aerofly at: " + path + "\n").c_str());
+                    HybridLogToFile("SUCCESS: Found Aerofly at: " + path);
+                    return path;
+                }
+                // Log attempted paths for debugging
+                HybridLogToFile("Checked path (not found): " + path);
+            }
+            
+            // Try registry-based discovery for Steam
+            std::string steam_path = GetSteamPathFromRegistry();
+            if (!steam_path.empty()) {
+                std::string aerofly_path = steam_path + "\\steamapps\\common\\Aerofly FS 4 Flight Simulator";
+                if (std::filesystem::exists(aerofly_path + "\\aircraft")) {
+                    OutputDebugStringA(("Found Aerofly via Steam registry: " + aerofly_path + "\n").c_str());
+                    return aerofly_path;
+                }
+            }
+            
+            OutputDebugStringA("WARNING: Aerofly FS 4 installation not found\n");
+            return "";
+        }
+        
+    private:
         static std::string GetSteamPathFromRegistry() {
             // Registry reading implementation for Steam path discovery
             // This is optional - if it fails, we fall back to static paths
@@ -1939,7 +3231,7 @@ class EnhancedTMDParser {
         
         // Variable discovery data
         std::vector<EnhancedVariableInfo> discovered_variables;
-        mutable std::unordered_map<std::string, const EnhancedVariableInfo*> variable_info_cache;
+        std::unordered_map<std::string, const EnhancedVariableInfo*> variable_info_cache;   // Built with discovered_variables
         std::string aerofly_path;
         bool discovery_completed;
         bool core_initialized;
@@ -1951,8 +3243,21 @@ class EnhancedTMDParser {
         // Shared memory interface
         AeroflyBridgeData* shared_data;
         
+        // Message hash -> dynamic_values slot, built once by PublishDynamicVariables()
+        std::unordered_map<tm_uint64, uint32_t> dynamic_slots;
+        
+        // GetDynamicMessage() cache per dynamic_values slot, also built by PublishDynamicVariables().
+        // The message is resolved on first use; both fields are read without the access mutex.
+        struct SlotMessage {
+            std::atomic<tm_external_message*> message;
+            bool is_toggle;
+        };
+        std::unique_ptr<SlotMessage[]> slot_messages;
+        uint32_t slot_message_count;
+        
     public:
-        HybridVariableManager() : discovery_completed(false), core_initialized(false), shared_data(nullptr) {}
+        HybridVariableManager() : discovery_completed(false), core_initialized(false), shared_data(nullptr),
+                                  slot_message_count(0) {}
         
 
         
@@ -2053,22 +3358,11 @@ class EnhancedTMDParser {
             discovered_count = static_cast<int>(discovered_variables.size());
         }
         
+        // Read-only, so any thread may call it: PerformDiscovery() fills
+        // the cache with every discovered variable before any command is processed
         const EnhancedVariableInfo* FindVariableInfo(const std::string& variable_name) const {
             auto it = variable_info_cache.find(variable_name);
-            if (it != variable_info_cache.end()) {
-                return it->second;
-            }
-            
-            // Search in discovered variables
-            for (const auto& var_info : discovered_variables) {
-                if (var_info.name == variable_name) {
-                    // Cache for future lookups
-                    variable_info_cache[variable_name] = &var_info;
-                    return &var_info;
-                }
-            }
-            
-            return nullptr;
+            return it != variable_info_cache.end() ? it->second : nullptr;
         }
     
         std::string FlagTypeToString(tm_msg_flag flag) const {
@@ -2119,6 +3413,43 @@ class EnhancedTMDParser {
             return details;
         }
 
+        // Slot in AeroflyBridgeData::dynamic_values for a received message ID.
+        // Read-only after discovery, so the sim thread may call it without the access mutex.
+        bool FindDynamicSlot(tm_uint64 message_id, uint32_t& slot) const {
+            auto it = dynamic_slots.find(message_id);
+            if (it == dynamic_slots.end()) return false;
+            slot = it->second;
+            return true;
+        }
+
+        bool FindDynamicSlot(const std::string& name, uint32_t& slot) const {
+            return FindDynamicSlot(CalculateRuntimeHash(name), slot);
+        }
+        
+        // Name of a published dynamic_values slot, nullptr if there is no such slot
+        const char* DynamicSlotName(uint32_t slot) const {
+            if (!shared_data || slot >= SharedAtomic(shared_data->dynamic_count).load(std::memory_order_acquire)) {
+                return nullptr;
+            }
+            return shared_data->dynamic_lookup[slot].name;
+        }
+        
+        // GetMessage() by dynamic_values slot, plus whether the variable toggles. Only the first
+        // call for a slot looks the name up, so handle commands take no lock and build no strings.
+        tm_external_message* GetDynamicMessage(uint32_t slot, bool& is_toggle) {
+            if (slot >= slot_message_count) return nullptr;
+            SlotMessage& entry = slot_messages[slot];
+            tm_external_message* message = entry.message.load(std::memory_order_acquire);
+            if (!message) {
+                const char* name = DynamicSlotName(slot);
+                message = name ? GetMessage(name) : nullptr;
+                if (!message) return nullptr;
+                entry.message.store(message, std::memory_order_release);
+            }
+            is_toggle = entry.is_toggle;
+            return message;
+        }
+
         std::string GetDiscoveryStatus() const {
             std::ostringstream status;
             status << "Aerofly Path: " << (aerofly_path.empty() ? "Not Found" : aerofly_path) << "\n";
@@ -2271,6 +3602,7 @@ class EnhancedTMDParser {
                 }
                 
                 discovery_completed = true;
+                PublishDynamicVariables();
                 UpdateSharedMemoryInfo();
                 
             } catch (const std::exception& e) {
@@ -2279,13 +3611,92 @@ class EnhancedTMDParser {
             }
         }
         
-        // Helper function to calculate FNV-1a hash at runtime (same algorithm as tm_string_hasher)
+        // Helper function to calculate FNV-1a hash at runtime (same algorithm as tm_string_hasher,
+        // which also folds in the terminating null character)
         static tm_uint64 CalculateRuntimeHash(const std::string& str) {
-            tm_uint64 hash = 14695981039346656037ull; // FNV offset basis
-            for (char c : str) {
-                hash = (hash ^ static_cast<tm_uint64>(c)) * 1099511628211ull; // FNV prime
+            return MessageNameHash(str);
+        }
+        
+        // Fills dynamic_lookup, its bucket index and the category/aircraft tables with the
+        // discovered variables that are not already core variables. Entries are written before
+        // dynamic_count is published, so readers never see a half-written entry.
+        void PublishDynamicVariables() {
+            dynamic_slots.clear();
+            slot_message_count = 0;
+            if (!shared_data) return;
+            
+            AeroflyBridgeData& data = *shared_data;
+            const uint32_t capacity = (uint32_t)(sizeof(data.dynamic_lookup) / sizeof(data.dynamic_lookup[0]));
+            slot_messages = std::make_unique<SlotMessage[]>(capacity);
+            const uint32_t max_categories = (uint32_t)(sizeof(data.categories) / sizeof(data.categories[0]));
+            const uint32_t max_aircraft = (uint32_t)(sizeof(data.aircraft) / sizeof(data.aircraft[0]));
+            const uint32_t mask = AeroflyBridgeData::DYNAMIC_BUCKET_COUNT - 1;
+            
+            SharedAtomic(data.dynamic_count).store(0, std::memory_order_release);
+            memset(data.dynamic_buckets, 0, sizeof(data.dynamic_buckets));
+            data.dynamic_capacity = capacity;
+            data.category_count = 0;
+            data.aircraft_count = 0;
+            
+            uint32_t count = 0;
+            for (const auto& var_info : discovered_variables) {
+                if (count == capacity) {
+                    HybridLogToFile("WARNING: dynamic_lookup full, " + std::to_string(discovered_variables.size()) +
+                                   " variables discovered");
+                    break;
+                }
+                if (var_info.name.empty() || var_info.name.size() >= sizeof(data.dynamic_lookup[0].name)) continue;
+                
+                const tm_uint64 message_id = CalculateRuntimeHash(var_info.name);
+                if (kMessageTable.Find(message_id)) continue;                 // Core variable, lives in all_variables
+                if (!dynamic_slots.emplace(message_id, count).second) continue;  // Same variable in another aircraft
+                
+                auto& entry = data.dynamic_lookup[count];
+                memset(&entry, 0, sizeof(entry));
+                strncpy_s(entry.name, sizeof(entry.name), var_info.name.c_str(), _TRUNCATE);
+                entry.value_index = count;
+                entry.name_hash = AeroflyBridgeData::ComputeHash(entry.name);
+                entry.category_id = (uint16_t)FindOrAddIndexEntry(data.categories, data.category_count, max_categories,
+                                                                  var_info.category, count);
+                const uint32_t aircraft_index = FindOrAddIndexEntry(data.aircraft, data.aircraft_count, max_aircraft,
+                                                                    var_info.aircraft, count);
+                entry.aircraft_id = (uint16_t)(aircraft_index < max_aircraft ? aircraft_index + 1 : 0);
+                data.dynamic_values[count] = 0.0;
+                
+                const EnhancedVariableInfo* info = FindVariableInfo(var_info.name);
+                slot_messages[count].is_toggle = info && info->is_toggle;
+                
+                uint32_t slot = entry.name_hash & mask;
+                while (data.dynamic_buckets[slot] != 0) {
+                    slot = (slot + 1) & mask;
+                }
+                data.dynamic_buckets[slot] = (uint16_t)(count + 1);
+                count++;
+            }
+            
+            slot_message_count = count;
+            SharedAtomic(data.dynamic_count).store(count, std::memory_order_release);
+            HybridLogToFile("Published " + std::to_string(count) + " dynamic variables to shared memory");
+        }
+        
+        // Category/aircraft table helper: returns the row for 'name' (adding it if there is room)
+        // and counts 'index' into it. Returns 'max_rows' when the table is full.
+        template <typename IndexInfo>
+        static uint32_t FindOrAddIndexEntry(IndexInfo* rows, uint32_t& row_count, uint32_t max_rows,
+                                            const std::string& name, uint32_t index) {
+            for (uint32_t i = 0; i < row_count; i++) {
+                if (strncmp(rows[i].name, name.c_str(), sizeof(rows[i].name)) == 0) {
+                    rows[i].count++;
+                    return i;
+                }
             }
-            return hash;
+            if (row_count == max_rows) return max_rows;
+            
+            IndexInfo& row = rows[row_count];
+            strncpy_s(row.name, sizeof(row.name), name.c_str(), _TRUNCATE);
+            row.start_index = index;
+            row.count = 1;
+            return row_count++;
         }
 
         std::unique_ptr<tm_external_message> CreateDynamicMessage(const std::string& variable_name) {
@@ -2373,6 +3784,15 @@ class EnhancedTMDParser {
         }
     };
     
+// Core variables resolve to their VariableIndex (the Value entry for shared names), discovered
+// variables to kDynamicHandleFlag | dynamic_values slot
+inline uint32_t ResolveVariableHandle(tm_uint64 hash, const HybridVariableManager* hybrid_manager) {
+    const MessageDescriptor* descriptor = kMessageTable.Find(hash);
+    if (descriptor) return (uint32_t)descriptor->variable_index;
+    uint32_t slot;
+    if (hybrid_manager && hybrid_manager->FindDynamicSlot(hash, slot)) return kDynamicHandleFlag | slot;
+    return kInvalidHandle;
+}
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 // SHARED MEMORY INTERFACE - Primary Interface
@@ -2382,24 +3802,121 @@ class SharedMemoryInterface {
 private:
     HANDLE hMapFile;
     AeroflyBridgeData* pData;
+    HANDLE hFramesFile;                 // Optional triple-buffered "AeroflyBridgeFrames"
+    AeroflyFrameBuffer* pFrames;
+    HANDLE hHistoryFile;                // Optional frame history "AeroflyBridgeHistory"
+    AeroflyHistoryRing* pHistory;
+    HANDLE hCommandsFile;               // Same-host command queue "AeroflyBridgeCommands"
+    AeroflyCommandRing* pCommands;
+    HANDLE hSchemaFile;                 // Layout description "AeroflyBridgeSchema"
+    AeroflyBridgeSchema* pSchema;
+    FrameSignal frame_signal;           // Wakes readers blocked in AeroflyFrameWaiter
+    const HybridVariableManager* hybrid_manager;  // Routes discovered (non-core) messages to dynamic_values
+    uint32_t frame_changed_groups;      // GroupBit() mask of groups changed by the current frame
     std::mutex data_mutex;
     bool initialized;
     
-public:
-    SharedMemoryInterface() : hMapFile(NULL), pData(nullptr), initialized(false) {}
+    // Creates (or opens) a named mapping and zeroes it; nullptr on failure
+    static void* CreateZeroedMapping(const char* name, size_t size, HANDLE& handle) {
+        handle = CreateFileMappingA(
+            INVALID_HANDLE_VALUE,
+            NULL,
+            PAGE_READWRITE,
+            (DWORD)((uint64_t)size >> 32),
+            (DWORD)(size & 0xFFFFFFFF),
+            name
+        );
+        if (handle == NULL) {
+            return nullptr;
+        }
+        
+        void* view = MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+        if (view == nullptr) {
+            CloseHandle(handle);
+            handle = NULL;
+            return nullptr;
+        }
+        
+        memset(view, 0, size);
+        return view;
+    }
     
-    ~SharedMemoryInterface() {
-        Cleanup();
+    bool InitializeFrameSlots() {
+        pFrames = (AeroflyFrameBuffer*)CreateZeroedMapping("AeroflyBridgeFrames", sizeof(AeroflyFrameBuffer), hFramesFile);
+        if (pFrames == nullptr) {
+            return false;
+        }
+        
+        pFrames->version = AeroflyFrameBuffer::VERSION;
+        pFrames->slot_count = AeroflyFrameBuffer::SLOT_COUNT;
+        pFrames->slot_size = sizeof(AeroflyFrameBuffer::FrameSlot);
+        pFrames->magic = AeroflyFrameBuffer::MAGIC;
+        return true;
     }
     
-    bool Initialize() {
-        try {
-            // Create shared memory region
-            hMapFile = CreateFileMappingA(
-                INVALID_HANDLE_VALUE,
-                NULL,
-                PAGE_READWRITE,
-                0,
+    bool InitializeSchema() {
+        pSchema = (AeroflyBridgeSchema*)CreateZeroedMapping("AeroflyBridgeSchema", sizeof(AeroflyBridgeSchema), hSchemaFile);
+        if (pSchema == nullptr) {
+            return false;
+        }
+        
+        // Magic last, so a client that attaches early sees either nothing or the complete block
+        memcpy(pSchema, &kBridgeSchema, sizeof(AeroflyBridgeSchema));
+        pSchema->magic = 0;
+        SharedAtomic(pSchema->magic).store(AeroflyBridgeSchema::MAGIC, std::memory_order_release);
+        return true;
+    }
+    
+    bool InitializeHistory(uint32_t history_frames) {
+        pHistory = (AeroflyHistoryRing*)CreateZeroedMapping("AeroflyBridgeHistory",
+                                                            AeroflyHistoryRing::SizeFor(history_frames), hHistoryFile);
+        if (pHistory == nullptr) {
+            return false;
+        }
+        
+        pHistory->version = AeroflyHistoryRing::VERSION;
+        pHistory->capacity = history_frames;
+        pHistory->entry_size = sizeof(AeroflyHistoryEntry);
+        pHistory->magic = AeroflyHistoryRing::MAGIC;
+        return true;
+    }
+    
+    bool InitializeCommandRing() {
+        pCommands = (AeroflyCommandRing*)CreateZeroedMapping("AeroflyBridgeCommands", sizeof(AeroflyCommandRing), hCommandsFile);
+        if (pCommands == nullptr) {
+            return false;
+        }
+        
+        pCommands->version = AeroflyCommandRing::VERSION;
+        pCommands->capacity = AeroflyCommandRing::CAPACITY;
+        pCommands->cell_size = sizeof(AeroflyCommandCell);
+        pCommands->completion_capacity = AeroflyCommandRing::COMPLETION_CAPACITY;
+        pCommands->completion_size = sizeof(AeroflyCommandCompletion);
+        pCommands->Reset();
+        SharedAtomic(pCommands->magic).store(AeroflyCommandRing::MAGIC, std::memory_order_release);
+        return true;
+    }
+    
+public:
+    SharedMemoryInterface() : hMapFile(NULL), pData(nullptr), hFramesFile(NULL), pFrames(nullptr),
+                              hHistoryFile(NULL), pHistory(nullptr), hCommandsFile(NULL), pCommands(nullptr), hSchemaFile(NULL), pSchema(nullptr), hybrid_manager(nullptr), frame_changed_groups(0),
+                              initialized(false) {}
+    
+    ~SharedMemoryInterface() {
+        Cleanup();
+    }
+    
+    // enable_frame_slots adds the "AeroflyBridgeFrames" mapping next to the legacy single-slot
+    // "AeroflyBridgeData", which keeps its layout for older clients.
+    // history_frames sizes the "AeroflyBridgeHistory" ring (0 = disabled).
+    bool Initialize(bool enable_frame_slots = true, uint32_t history_frames = 512) {
+        try {
+            // Create shared memory region
+            hMapFile = CreateFileMappingA(
+                INVALID_HANDLE_VALUE,
+                NULL,
+                PAGE_READWRITE,
+                0,
                 sizeof(AeroflyBridgeData),
                 "AeroflyBridgeData"
             );
@@ -2428,6 +3945,25 @@ public:
             memset(pData, 0, sizeof(AeroflyBridgeData));
             pData->data_valid = 0;
             pData->update_counter = 0;
+            pData->layout_version = AeroflyBridgeData::LAYOUT_VERSION;
+            
+            if (!InitializeSchema()) {
+                OutputDebugStringA("WARNING: AeroflyBridgeSchema mapping not available\n");
+            }
+            if (enable_frame_slots && !InitializeFrameSlots()) {
+                // Not critical, the single-slot layout still works
+                OutputDebugStringA("WARNING: AeroflyBridgeFrames mapping not available\n");
+            }
+            if (history_frames > 0 && !InitializeHistory(history_frames)) {
+                OutputDebugStringA("WARNING: AeroflyBridgeHistory mapping not available\n");
+            }
+            if (!InitializeCommandRing()) {
+                // TCP commands still work
+                OutputDebugStringA("WARNING: AeroflyBridgeCommands mapping not available\n");
+            }
+            if (!frame_signal.Create()) {
+                OutputDebugStringA("WARNING: Frame notification events not available, readers must poll\n");
+            }
             
             initialized = true;
             return true;
@@ -2437,464 +3973,131 @@ public:
         }
     }
     
-    void UpdateData(const std::vector<tm_external_message>& messages, double delta_time) {
+    void UpdateData(const MessageStreamView& messages, double delta_time) {
         if (!initialized || !pData) return;
         
         std::lock_guard<std::mutex> lock(data_mutex);
         
+        // Seqlock: sequence goes odd before the first store of the frame...
+        std::atomic<uint32_t>& sequence = pData->Sequence();
+        const uint32_t frame_start = sequence.load(std::memory_order_relaxed) | 1;
+        sequence.store(frame_start, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        
         // Update timestamp and counter
         pData->timestamp_us = GetTickCount64() * 1000; // Convert to microseconds
         pData->update_counter++;
+        frame_changed_groups = 0;
+        
+        // Change journal starts empty (only cleared if the previous frame left bits set)
+        if (pData->changed_count != 0) {
+            memset(pData->changed_bitmap, 0, sizeof(pData->changed_bitmap));
+        }
+        if (pData->dynamic_changed_count != 0) {
+            memset(pData->dynamic_changed_bitmap, 0, sizeof(pData->dynamic_changed_bitmap));
+            pData->dynamic_changed_count = 0;
+        }
         
         // Process all received messages
         for (const auto& message : messages) {
             ProcessMessage(message);
         }
+        pData->changed_count = ExtractChangedIndices(pData->changed_bitmap, AeroflyFrameData::CHANGED_BITMAP_WORDS,
+                                                     pData->changed_indices);
         
         // Mark data as valid
         pData->data_valid = 1;
-    }
-    
-    void ProcessMessage(const tm_external_message& message) {
-        const auto hash = message.GetStringHash().GetHash();
-        
-        // Add error handling for assertion failures
-        try {
-            // === AIRCRAFT BASIC DATA ===
-            if (hash == MessageAircraftUniversalTime.GetID()) {
-                pData->all_variables[(int)VariableIndex::AIRCRAFT_UNIVERSAL_TIME] = message.GetDouble();
-            }
-        else if (hash == MessageAircraftLatitude.GetID()) {
-            pData->latitude = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_LATITUDE] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftLongitude.GetID()) {
-            pData->longitude = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_LONGITUDE] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftAltitude.GetID()) {
-            pData->altitude = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_ALTITUDE] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftPitch.GetID()) {
-            pData->pitch = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_PITCH] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftBank.GetID()) {
-            pData->bank = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_BANK] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftTrueHeading.GetID()) {
-            pData->true_heading = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_TRUE_HEADING] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftMagneticHeading.GetID()) {
-            pData->magnetic_heading = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_MAGNETIC_HEADING] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftIndicatedAirspeed.GetID()) {
-            pData->indicated_airspeed = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_INDICATED_AIRSPEED] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftIndicatedAirspeedTrend.GetID()) {
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_INDICATED_AIRSPEED_TREND] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftGroundSpeed.GetID()) {
-            pData->ground_speed = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_GROUND_SPEED] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftVerticalSpeed.GetID()) {
-            pData->vertical_speed = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_VERTICAL_SPEED] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftHeight.GetID()) {
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_HEIGHT] = message.GetDouble();
-        }
-        
-        // === AIRCRAFT PHYSICS ===
-        else if (hash == MessageAircraftPosition.GetID()) {
-            pData->position = message.GetVector3d();
-        }
-        else if (hash == MessageAircraftVelocity.GetID()) {
-            pData->velocity = message.GetVector3d();
-        }
-        else if (hash == MessageAircraftAcceleration.GetID()) {
-            pData->acceleration = message.GetVector3d();
-        }
-        else if (hash == MessageAircraftAngularVelocity.GetID()) {
-            pData->angular_velocity = message.GetVector3d();
-        }
-        else if (hash == MessageAircraftGravity.GetID()) {
-            pData->gravity = message.GetVector3d();
-        }
-        else if (hash == MessageAircraftWind.GetID()) {
-            pData->wind = message.GetVector3d();
-        }
-        else if (hash == MessageAircraftRateOfTurn.GetID()) {
-            pData->rate_of_turn = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_RATE_OF_TURN] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftMachNumber.GetID()) {
-            pData->mach_number = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_MACH_NUMBER] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftAngleOfAttack.GetID()) {
-            pData->angle_of_attack = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_ANGLE_OF_ATTACK] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftAngleOfAttackLimit.GetID()) {
-            pData->angle_of_attack_limit = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_ANGLE_OF_ATTACK_LIMIT] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftAccelerationLimit.GetID()) {
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_ACCELERATION_LIMIT] = message.GetDouble();
-        }
-        
-        // === AIRCRAFT STATE ===
-        else if (hash == MessageAircraftOnGround.GetID()) {
-            pData->on_ground = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_ON_GROUND] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftOnRunway.GetID()) {
-            pData->on_runway = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_ON_RUNWAY] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftCrashed.GetID()) {
-            // TEMPORARILY COMMENTED OUT - DOUBLE ASSERTION FAILURE DURING CRASH
-            // pData->crashed = message.GetDouble();
-            // pData->all_variables[(int)VariableIndex::AIRCRAFT_CRASHED] = message.GetDouble();
-            // Set default value for now - crash detection via other means
-            pData->crashed = 0.0;
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_CRASHED] = 0.0;
-            OutputDebugStringA("WARNING: Aircraft.Crashed variable temporarily disabled due to type assertion error\n");
-        }
-        else if (hash == MessageAircraftGear.GetID()) {
-            pData->gear_position = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_GEAR] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftFlaps.GetID()) {
-            pData->flaps_position = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_FLAPS] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftSlats.GetID()) {
-            pData->slats_position = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_SLATS] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftThrottle.GetID()) {
-            pData->throttle_position = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_THROTTLE] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftAirBrake.GetID()) {
-            pData->airbrake_position = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_AIR_BRAKE] = message.GetDouble();
-        }
-        
-        // === ENGINE DATA ===
-        else if (hash == MessageAircraftEngineThrottle1.GetID()) {
-            pData->engine_throttle[0] = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_ENGINE_THROTTLE_1] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftEngineThrottle2.GetID()) {
-            pData->engine_throttle[1] = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_ENGINE_THROTTLE_2] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftEngineThrottle3.GetID()) {
-            pData->engine_throttle[2] = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_ENGINE_THROTTLE_3] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftEngineThrottle4.GetID()) {
-            pData->engine_throttle[3] = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_ENGINE_THROTTLE_4] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftEngineRotationSpeed1.GetID()) {
-            pData->engine_rotation_speed[0] = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_ENGINE_ROTATION_SPEED_1] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftEngineRotationSpeed2.GetID()) {
-            pData->engine_rotation_speed[1] = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_ENGINE_ROTATION_SPEED_2] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftEngineRotationSpeed3.GetID()) {
-            pData->engine_rotation_speed[2] = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_ENGINE_ROTATION_SPEED_3] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftEngineRotationSpeed4.GetID()) {
-            pData->engine_rotation_speed[3] = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_ENGINE_ROTATION_SPEED_4] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftEngineRunning1.GetID()) {
-            pData->engine_running[0] = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_ENGINE_RUNNING_1] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftEngineRunning2.GetID()) {
-            pData->engine_running[1] = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_ENGINE_RUNNING_2] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftEngineRunning3.GetID()) {
-            pData->engine_running[2] = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_ENGINE_RUNNING_3] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftEngineRunning4.GetID()) {
-            pData->engine_running[3] = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_ENGINE_RUNNING_4] = message.GetDouble();
-        }
-        
-        // === PERFORMANCE SPEEDS ===
-        else if (hash == MessagePerformanceSpeedVS0.GetID()) {
-            pData->vs0_speed = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::PERFORMANCE_SPEED_VS0] = message.GetDouble();
-        }
-        else if (hash == MessagePerformanceSpeedVS1.GetID()) {
-            pData->vs1_speed = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::PERFORMANCE_SPEED_VS1] = message.GetDouble();
-        }
-        else if (hash == MessagePerformanceSpeedVFE.GetID()) {
-            pData->vfe_speed = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::PERFORMANCE_SPEED_VFE] = message.GetDouble();
-        }
-        else if (hash == MessagePerformanceSpeedVNO.GetID()) {
-            pData->vno_speed = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::PERFORMANCE_SPEED_VNO] = message.GetDouble();
-        }
-        else if (hash == MessagePerformanceSpeedVNE.GetID()) {
-            pData->vne_speed = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::PERFORMANCE_SPEED_VNE] = message.GetDouble();
-        }
-        
-        // === NAVIGATION ===
-        else if (hash == MessageNavigationSelectedCourse1.GetID()) {
-            pData->nav1_selected_course = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::NAVIGATION_SELECTED_COURSE_1] = message.GetDouble();
-        }
-        else if (hash == MessageNavigationSelectedCourse2.GetID()) {
-            pData->nav2_selected_course = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::NAVIGATION_SELECTED_COURSE_2] = message.GetDouble();
-        }
-        else if (hash == MessageNavigationNAV1Frequency.GetID()) {
-            pData->nav1_frequency = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::NAVIGATION_NAV1_FREQUENCY] = message.GetDouble();
-        }
-        else if (hash == MessageNavigationNAV1StandbyFrequency.GetID()) {
-            pData->nav1_standby_frequency = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::NAVIGATION_NAV1_STANDBY_FREQUENCY] = message.GetDouble();
-        }
-        else if (hash == MessageNavigationNAV2Frequency.GetID()) {
-            pData->nav2_frequency = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::NAVIGATION_NAV2_FREQUENCY] = message.GetDouble();
-        }
-        else if (hash == MessageNavigationNAV2StandbyFrequency.GetID()) {
-            pData->nav2_standby_frequency = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::NAVIGATION_NAV2_STANDBY_FREQUENCY] = message.GetDouble();
-        }
-        
-        // === COMMUNICATION ===
-        else if (hash == MessageNavigationCOM1Frequency.GetID()) {
-            pData->com1_frequency = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::COMMUNICATION_COM1_FREQUENCY] = message.GetDouble();
-        }
-        else if (hash == MessageNavigationCOM1StandbyFrequency.GetID()) {
-            pData->com1_standby_frequency = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::COMMUNICATION_COM1_STANDBY_FREQUENCY] = message.GetDouble();
-        }
-        else if (hash == MessageNavigationCOM2Frequency.GetID()) {
-            pData->com2_frequency = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::COMMUNICATION_COM2_FREQUENCY] = message.GetDouble();
-        }
-        else if (hash == MessageNavigationCOM2StandbyFrequency.GetID()) {
-            pData->com2_standby_frequency = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::COMMUNICATION_COM2_STANDBY_FREQUENCY] = message.GetDouble();
-        }
         
-        // === AUTOPILOT ===
-        else if (hash == MessageAutopilotEngaged.GetID()) {
-            pData->ap_engaged = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AUTOPILOT_ENGAGED] = message.GetDouble();
-        }
-        else if (hash == MessageAutopilotSelectedAirspeed.GetID()) {
-            pData->ap_selected_airspeed = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AUTOPILOT_SELECTED_AIRSPEED] = message.GetDouble();
-        }
-        else if (hash == MessageAutopilotSelectedHeading.GetID()) {
-            pData->ap_selected_heading = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AUTOPILOT_SELECTED_HEADING] = message.GetDouble();
-        }
-        else if (hash == MessageAutopilotSelectedAltitude.GetID()) {
-            pData->ap_selected_altitude = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AUTOPILOT_SELECTED_ALTITUDE] = message.GetDouble();
-        }
-        else if (hash == MessageAutopilotSelectedVerticalSpeed.GetID()) {
-            pData->ap_selected_vs = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AUTOPILOT_SELECTED_VERTICAL_SPEED] = message.GetDouble();
-        }
-        else if (hash == MessageAutopilotThrottleEngaged.GetID()) {
-            pData->ap_throttle_engaged = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::AUTOPILOT_THROTTLE_ENGAGED] = message.GetDouble();
-        }
-        else if (hash == MessageAutopilotActiveLateralMode.GetID()) {
-            // TEMPORARILY COMMENTED OUT - STRING ASSERTION FAILURE
-            // const auto mode_str = message.GetString();
-            // strncpy_s(pData->ap_lateral_mode, sizeof(pData->ap_lateral_mode), mode_str.c_str(), _TRUNCATE);
-            // Set default value for now
-            strncpy_s(pData->ap_lateral_mode, sizeof(pData->ap_lateral_mode), "Manual", _TRUNCATE);
-        }
-        else if (hash == MessageAutopilotActiveVerticalMode.GetID()) {
-            // TEMPORARILY COMMENTED OUT - STRING ASSERTION FAILURE
-            // const auto mode_str = message.GetString();
-            // strncpy_s(pData->ap_vertical_mode, sizeof(pData->ap_vertical_mode), mode_str.c_str(), _TRUNCATE);
-            // Set default value for now
-            strncpy_s(pData->ap_vertical_mode, sizeof(pData->ap_vertical_mode), "Manual", _TRUNCATE);
-        }
+        // ...and even again once the whole frame is visible
+        sequence.store(frame_start + 1, std::memory_order_release);
         
-        // === CONTROLS ===
-        else if (hash == MessageControlsPitchInput.GetID()) {
-            pData->pitch_input = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::CONTROLS_PITCH_INPUT] = message.GetDouble();
-        }
-        else if (hash == MessageControlsRollInput.GetID()) {
-            pData->roll_input = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::CONTROLS_ROLL_INPUT] = message.GetDouble();
-        }
-        else if (hash == MessageControlsYawInput.GetID()) {
-            pData->yaw_input = message.GetDouble();
-            pData->all_variables[(int)VariableIndex::CONTROLS_YAW_INPUT] = message.GetDouble();
-        }
-        else if (hash == MessageControlsThrottle.GetID()) {
-            pData->all_variables[(int)VariableIndex::CONTROLS_THROTTLE] = message.GetDouble();
-        }
-        else if (hash == MessageControlsGear.GetID()) {
-            pData->all_variables[(int)VariableIndex::CONTROLS_GEAR] = message.GetDouble();
-        }
-        else if (hash == MessageControlsFlaps.GetID()) {
-            pData->all_variables[(int)VariableIndex::CONTROLS_FLAPS] = message.GetDouble();
+        // Triple-buffered copy for readers that cannot afford seqlock retries
+        if (pFrames) {
+            pFrames->Publish(*pData);
         }
         
-        // === ADDITIONAL CONTROL VARIABLES ===
-        else if (hash == MessageControlsWheelBrakeLeft.GetID()) {
-            pData->all_variables[(int)VariableIndex::CONTROLS_WHEEL_BRAKE_LEFT] = message.GetDouble();
-        }
-        else if (hash == MessageControlsWheelBrakeRight.GetID()) {
-            pData->all_variables[(int)VariableIndex::CONTROLS_WHEEL_BRAKE_RIGHT] = message.GetDouble();
-        }
-        else if (hash == MessageControlsAirBrake.GetID()) {
-            pData->all_variables[(int)VariableIndex::CONTROLS_AIR_BRAKE] = message.GetDouble();
-        }
-        else if (hash == MessageControlsAirBrakeArm.GetID()) {
-            pData->all_variables[(int)VariableIndex::CONTROLS_AIR_BRAKE_ARM] = message.GetDouble();
-        }
-        else if (hash == MessageControlsPropellerSpeed1.GetID()) {
-            pData->all_variables[(int)VariableIndex::CONTROLS_PROPELLER_SPEED_1] = message.GetDouble();
-        }
-        else if (hash == MessageControlsPropellerSpeed2.GetID()) {
-            pData->all_variables[(int)VariableIndex::CONTROLS_PROPELLER_SPEED_2] = message.GetDouble();
-        }
-        else if (hash == MessageControlsPropellerSpeed3.GetID()) {
-            pData->all_variables[(int)VariableIndex::CONTROLS_PROPELLER_SPEED_3] = message.GetDouble();
-        }
-        else if (hash == MessageControlsPropellerSpeed4.GetID()) {
-            pData->all_variables[(int)VariableIndex::CONTROLS_PROPELLER_SPEED_4] = message.GetDouble();
-        }
-        else if (hash == MessageControlsGliderAirBrake.GetID()) {
-            pData->all_variables[(int)VariableIndex::CONTROLS_GLIDER_AIR_BRAKE] = message.GetDouble();
-        }
-        else if (hash == MessageControlsRotorBrake.GetID()) {
-            pData->all_variables[(int)VariableIndex::CONTROLS_ROTOR_BRAKE] = message.GetDouble();
+        // History ring for readers that missed frames
+        if (pHistory) {
+            pHistory->Append(*pData, delta_time);
         }
         
-        // === AIRCRAFT SYSTEM VARIABLES ===
-        else if (hash == MessageAircraftGroundSpoilersArmed.GetID()) {
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_GROUND_SPOILERS_ARMED] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftGroundSpoilersExtended.GetID()) {
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_GROUND_SPOILERS_EXTENDED] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftParkingBrake.GetID()) {
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_PARKING_BRAKE] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftAutoBrakeSetting.GetID()) {
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_AUTO_BRAKE_SETTING] = message.GetDouble();
+        // Per-group change counters, then wake blocked readers
+        for (int g = 0; g < (int)VariableGroup::GROUP_COUNT; g++) {
+            if (frame_changed_groups & (1u << g)) {
+                SharedAtomic(pData->group_changed_frame[g]).store(pData->update_counter, std::memory_order_release);
+            }
         }
-        else if (hash == MessageAircraftAutoBrakeEngaged.GetID()) {
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_AUTO_BRAKE_ENGAGED] = message.GetDouble();
+        frame_signal.Notify(pData->update_counter);
+    }
+    
+    void ProcessMessage(const MessageView& message) {
+        // O(1) lookup in the table generated from MESSAGE_LIST (covers all 339 variables)
+        const MessageDescriptor* descriptor = kMessageTable.Find(message.GetID());
+        if (!descriptor) {
+            ProcessDynamicMessage(message);
+            return;
         }
-        else if (hash == MessageAircraftAutoBrakeRejectedTakeOff.GetID()) {
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_AUTO_BRAKE_REJECTED_TAKEOFF] = message.GetDouble();
+
+        if (DecodeMessageValue(*descriptor, message.GetDataType(), message.payload, message.payload_size, *pData)) {
+            SetChangedBit(pData->changed_bitmap, (uint32_t)descriptor->variable_index);
+            frame_changed_groups |= GroupBit(descriptor->group);
         }
+    }
+    
+    void ProcessDynamicMessage(const MessageView& message) {
+        uint32_t slot;
+        double value;
+        if (!hybrid_manager || !hybrid_manager->FindDynamicSlot(message.GetID(), slot)) return;
+        if (!DecodeScalarValue(message.GetDataType(), message.payload, message.payload_size, value)) return;
         
-        // === ENGINE SYSTEM VARIABLES ===
-        else if (hash == MessageAircraftStarter.GetID()) {
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_STARTER] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftStarter1.GetID()) {
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_STARTER_1] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftStarter2.GetID()) {
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_STARTER_2] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftStarter3.GetID()) {
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_STARTER_3] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftStarter4.GetID()) {
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_STARTER_4] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftIgnition.GetID()) {
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_IGNITION] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftIgnition1.GetID()) {
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_IGNITION_1] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftIgnition2.GetID()) {
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_IGNITION_2] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftIgnition3.GetID()) {
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_IGNITION_3] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftIgnition4.GetID()) {
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_IGNITION_4] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftEngineMaster1.GetID()) {
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_ENGINE_MASTER_1] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftEngineMaster2.GetID()) {
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_ENGINE_MASTER_2] = message.GetDouble();
-        }
-        else if (hash == MessageAircraftEngineMaster3.GetID()) {
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_ENGINE_MASTER_3] = message.GetDouble();
+        if (memcmp(&pData->dynamic_values[slot], &value, sizeof(value)) != 0) {
+            pData->dynamic_values[slot] = value;
+            if (!TestChangedBit(pData->dynamic_changed_bitmap, slot)) {
+                SetChangedBit(pData->dynamic_changed_bitmap, slot);
+                pData->dynamic_changed_count++;
+            }
         }
-        else if (hash == MessageAircraftEngineMaster4.GetID()) {
-            pData->all_variables[(int)VariableIndex::AIRCRAFT_ENGINE_MASTER_4] = message.GetDouble();
+    }
+    
+    void SetHybridManager(const HybridVariableManager* manager) {
+        std::lock_guard<std::mutex> lock(data_mutex);
+        hybrid_manager = manager;
+    }
+    
+    void Cleanup() {
+        frame_signal.Close();
+        if (pSchema) {
+            UnmapViewOfFile(pSchema);
+            pSchema = nullptr;
         }
-        
-        // === WARNINGS ===
-        else if (hash == MessageWarningsMasterWarning.GetID()) {
-            pData->master_warning = (uint32_t)message.GetDouble();
-            pData->all_variables[(int)VariableIndex::WARNINGS_MASTER_WARNING] = message.GetDouble();
+        if (hSchemaFile) {
+            CloseHandle(hSchemaFile);
+            hSchemaFile = NULL;
         }
-        else if (hash == MessageWarningsMasterCaution.GetID()) {
-            pData->master_caution = (uint32_t)message.GetDouble();
-            pData->all_variables[(int)VariableIndex::WARNINGS_MASTER_CAUTION] = message.GetDouble();
+        if (pHistory) {
+            UnmapViewOfFile(pHistory);
+            pHistory = nullptr;
         }
-        else if (hash == MessageWarningsLowOilPressure.GetID()) {
-            pData->all_variables[(int)VariableIndex::WARNINGS_LOW_OIL_PRESSURE] = message.GetDouble();
+        if (hHistoryFile) {
+            CloseHandle(hHistoryFile);
+            hHistoryFile = NULL;
         }
-        else if (hash == MessageWarningsLowFuelPressure.GetID()) {
-            pData->all_variables[(int)VariableIndex::WARNINGS_LOW_FUEL_PRESSURE] = message.GetDouble();
+        if (pCommands) {
+            UnmapViewOfFile(pCommands);
+            pCommands = nullptr;
         }
-        
-        // NOTE: This implementation now covers ~100 variables
-        // Added critical aircraft system variables for comprehensive monitoring
+        if (hCommandsFile) {
+            CloseHandle(hCommandsFile);
+            hCommandsFile = NULL;
         }
-        catch (const std::exception& e) {
-            // Log the error and continue processing
-            std::string error_msg = "ERROR: Exception in ProcessMessage: " + std::string(e.what()) + "\n";
-            OutputDebugStringA(error_msg.c_str());
+        if (pFrames) {
+            UnmapViewOfFile(pFrames);
+            pFrames = nullptr;
         }
-        catch (...) {
-            // Handle any other exceptions (including assertion failures)
-            OutputDebugStringA("ERROR: Unknown exception in ProcessMessage (possibly assertion failure)\n");
+        if (hFramesFile) {
+            CloseHandle(hFramesFile);
+            hFramesFile = NULL;
         }
-    }
-    
-    void Cleanup() {
         if (pData) {
             UnmapViewOfFile(pData);
             pData = nullptr;
@@ -2907,761 +4110,2571 @@ public:
     }
     
     AeroflyBridgeData* GetData() { return pData; }
+    const AeroflyFrameBuffer* GetFrames() const { return pFrames; }
+    const AeroflyHistoryRing* GetHistory() const { return pHistory; }
+    AeroflyCommandRing* GetCommandRing() { return pCommands; }
+    const AeroflyBridgeSchema* GetSchema() const { return pSchema; }
     bool IsInitialized() const { return initialized; }
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-// TCP SERVER INTERFACE - Network Interface
+// FRAME BROADCAST - Sender pool for the TCP data stream
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-class TCPServerInterface {
+// Encoded data-stream frame, shared by every client queue it was pushed to
+using EncodedFrame = std::shared_ptr<const std::string>;
+
+// Frame snapshot for the encoder thread: the frame plus the dynamic values that data-stream
+// subscriptions asked for (in TCPServerInterface::stream_dynamic_slots order)
+struct StreamFrame {
+    static constexpr uint32_t MAX_DYNAMIC = 64;
+
+    AeroflyFrameData frame;
+    uint32_t dynamic_count;
+    uint32_t dynamic_slots[MAX_DYNAMIC];    // dynamic_values slot each value was read from
+    double dynamic_values[MAX_DYNAMIC];
+};
+
+// Bounded hand-off of frame snapshots from the sim thread to the encoder thread. Slots are
+// preallocated, so Push() is a short lock plus one memcpy; when the encoder falls behind,
+// the oldest pending frame is dropped.
+class FrameMailbox {
+public:
+    static constexpr uint32_t CAPACITY = 4;
+
 private:
-    SOCKET server_socket;
-    std::vector<SOCKET> client_sockets;
-    std::thread server_thread;
-    std::thread command_thread;
-    std::atomic<bool> running;
-    mutable std::mutex clients_mutex;
-    VariableMapper mapper;
-    
-    // Command processing
-    std::queue<std::string> command_queue;
-    mutable std::mutex command_mutex;
-    
+    std::vector<StreamFrame> slots;
+    uint32_t head;
+    uint32_t count;
+    bool closed;
+    std::mutex mutex;
+    std::condition_variable ready;
+
 public:
-    TCPServerInterface() : server_socket(INVALID_SOCKET), running(false) {}
-    
-    ~TCPServerInterface() {
-        Stop();
-    }
-    
-    bool Start(int data_port = 12345, int command_port = 12346) {
-        // Initialize Winsock
-        WSADATA wsaData;
-        if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
-            return false;
-        }
-        
-        // Create server socket for data
-        server_socket = socket(AF_INET, SOCK_STREAM, 0);
-        if (server_socket == INVALID_SOCKET) {
-            WSACleanup();
-            return false;
-        }
-        
-        // Allow socket reuse
-        int opt = 1;
-        setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, (char*)&opt, sizeof(opt));
-        
-        // Bind to data port
-        sockaddr_in server_addr;
-        server_addr.sin_family = AF_INET;
-        server_addr.sin_addr.s_addr = INADDR_ANY;
-        server_addr.sin_port = htons(data_port);
-        
-        if (bind(server_socket, (sockaddr*)&server_addr, sizeof(server_addr)) == SOCKET_ERROR) {
-            closesocket(server_socket);
-            WSACleanup();
-            return false;
-        }
-        
-        // Listen for connections
-        if (listen(server_socket, 5) == SOCKET_ERROR) {
-            closesocket(server_socket);
-            WSACleanup();
-            return false;
+    std::atomic<uint64_t> frames_dropped;
+
+    FrameMailbox() : slots(CAPACITY), head(0), count(0), closed(true), frames_dropped(0) {}
+
+    // dynamic_slots: dynamic_values entries to snapshot along with the frame (at most MAX_DYNAMIC)
+    void Push(const AeroflyFrameData& frame, const double* dynamic_values, const std::atomic<uint32_t>* dynamic_slots,
+              uint32_t dynamic_count) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (closed) return;
+            if (count == CAPACITY) {
+                head = (head + 1) % CAPACITY;
+                count--;
+                frames_dropped++;
+            }
+            StreamFrame& slot = slots[(head + count) % CAPACITY];
+            memcpy(&slot.frame, &frame, sizeof(AeroflyFrameData));
+            slot.dynamic_count = dynamic_count;
+            for (uint32_t i = 0; i < dynamic_count; i++) {
+                slot.dynamic_slots[i] = dynamic_slots[i].load(std::memory_order_relaxed);
+                slot.dynamic_values[i] = dynamic_values[slot.dynamic_slots[i]];
+            }
+            count++;
         }
-        
-        // Start server thread
-        running = true;
-        server_thread = std::thread(&TCPServerInterface::ServerLoop, this);
-        command_thread = std::thread(&TCPServerInterface::CommandLoop, this, command_port);
-        
+        ready.notify_one();
+    }
+
+    // Blocks until a frame is available; false once Close() was called
+    bool Pop(StreamFrame& frame) {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [this] { return count > 0 || closed; });
+        if (closed) return false;
+        memcpy(&frame, &slots[head], sizeof(StreamFrame));
+        head = (head + 1) % CAPACITY;
+        count--;
         return true;
     }
-    
-    void Stop() {
-        OutputDebugStringA("=== TCPServer::Stop() STARTED ===\n");
-        
-        // Mark as not running FIRST
-        running = false;
-        
-        // Close server socket to wake up blocked accept()
-        if (server_socket != INVALID_SOCKET) {
-            OutputDebugStringA("Closing main server socket...\n");
-            shutdown(server_socket, SD_BOTH);  // Shutdown before close
-            closesocket(server_socket);
-            server_socket = INVALID_SOCKET;
-        }
-        
-        // Close all client connections
+
+    void Open() {
+        std::lock_guard<std::mutex> lock(mutex);
+        head = 0;
+        count = 0;
+        closed = false;
+    }
+
+    void Close() {
         {
-            std::lock_guard<std::mutex> lock(clients_mutex);
-            OutputDebugStringA("Closing client connections...\n");
-            for (SOCKET client : client_sockets) {
-                shutdown(client, SD_BOTH);
-                closesocket(client);
-            }
-            client_sockets.clear();
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
         }
-        
-        // Wait for threads to finish with TIMEOUT
-        if (server_thread.joinable()) {
-            OutputDebugStringA("Waiting for server_thread...\n");
-            server_thread.join();
-            OutputDebugStringA("server_thread finished\n");
+        ready.notify_all();
+    }
+};
+
+struct StreamSubscription;
+
+// One data-stream client: a bounded queue of encoded frames (drop-oldest) drained with
+// non-blocking sends, so a slow client only loses its own frames.
+struct BroadcastClient {
+    static constexpr size_t MAX_QUEUED_FRAMES = 8;
+    static constexpr uint32_t EVICT_AFTER_DROPS = 300;  // ~5 s at 60 Hz without completing a single frame
+    static constexpr ULONGLONG HANDSHAKE_GRACE_MS = 250;  // Silent clients get JSON after this
+    static constexpr size_t MAX_HANDSHAKE = 4096;  // Long enough for a VARS= list
+
+    enum class FlushResult { Drained, WouldBlock, Failed };
+
+    // Chosen by the first line the client sends ("BINARY" or "JSON", plus "DELTA" for delta
+    // frames and VARS=/RATE= for a subscription), full JSON frames when it sends nothing
+    enum class StreamMode { Pending, Json, Binary };
+
+    SOCKET socket;
+    std::deque<EncodedFrame> queue;     // Oldest first
+    size_t front_offset;                // Bytes of queue.front() already sent
+    uint64_t frames_dropped;
+    uint32_t drops_since_send;          // Reset whenever a frame has been sent completely
+    StreamMode mode;
+    bool delta;                         // Keyframe, then changes only (encoder decides per frame)
+    uint32_t last_sequence;             // update_counter of the last queued frame, 0 = delta chain broken
+    ULONGLONG connected_tick;           // GetTickCount64() at accept
+    std::string handshake;              // First line; complete once mode is no longer Pending
+    std::shared_ptr<StreamSubscription> subscription;   // Assigned by the encoder thread once mode is known
+
+    BroadcastClient(SOCKET s, ULONGLONG now) : socket(s), front_offset(0), frames_dropped(0), drops_since_send(0),
+                                               mode(StreamMode::Pending), delta(false), last_sequence(0),
+                                               connected_tick(now) {}
+
+    // Feeds bytes received from the client; only the first line matters, the rest is ignored
+    void ReceiveHandshake(const char* data, size_t size) {
+        if (mode != StreamMode::Pending) return;
+        for (size_t i = 0; i < size; ++i) {
+            if (data[i] == '\n' || handshake.size() >= MAX_HANDSHAKE) {
+                std::istringstream tokens(handshake);
+                std::string token;
+                bool binary = false;
+                while (tokens >> token) {
+                    binary |= token == "BINARY";
+                    delta |= token == "DELTA";
+                }
+                mode = binary ? StreamMode::Binary : StreamMode::Json;
+                return;
+            }
+            handshake.push_back(data[i]);
         }
-        
-        if (command_thread.joinable()) {
-            OutputDebugStringA("Waiting for command_thread...\n");
-            command_thread.join();
-            OutputDebugStringA("command_thread finished\n");
+    }
+
+    // Resolves a client that never sent a handshake line; true once the mode is known
+    bool ResolveMode(ULONGLONG now) {
+        if (mode == StreamMode::Pending && now - connected_tick >= HANDSHAKE_GRACE_MS) {
+            mode = StreamMode::Json;
         }
-        
-        OutputDebugStringA("=== TCPServer::Stop() COMPLETED ===\n");
+        return mode != StreamMode::Pending;
     }
-    
-    void BroadcastData(const AeroflyBridgeData* data) {
-        if (!data || !running) return;
-        
-        // Create JSON message with proper formatting
-        std::string json_data = CreateDataJSON(data);
-        
-        std::lock_guard<std::mutex> lock(clients_mutex);
-        
-        // Send to all connected clients
-        auto it = client_sockets.begin();
-        while (it != client_sockets.end()) {
-            // CRITICAL FIX 3: Send complete JSON in one operation to avoid fragmentation
-            int total_sent = 0;
-            int data_size = static_cast<int>(json_data.length());
-            const char* data_ptr = json_data.c_str();
-            
-            bool send_successful = true;
-            
-            // Ensure complete JSON is sent
-            while (total_sent < data_size && send_successful) {
-                int result = send(*it, data_ptr + total_sent, data_size - total_sent, 0);
-                if (result == SOCKET_ERROR) {
-                    send_successful = false;
-                    break;
-                }
-                total_sent += result;
+
+    // Returns false if an older frame had to be dropped to make room
+    bool Enqueue(const EncodedFrame& frame) {
+        bool dropped = false;
+        if (queue.size() >= MAX_QUEUED_FRAMES) {
+            // Never drop a partially sent frame, the client would receive broken JSON
+            queue.erase(queue.begin() + (front_offset > 0 ? 1 : 0));
+            frames_dropped++;
+            drops_since_send++;
+            dropped = true;
+        }
+        queue.push_back(frame);
+        return !dropped;
+    }
+
+    // Drops every frame not yet started (delta frames are useless once one is lost); returns the count
+    size_t DropUnsent() {
+        const size_t keep = front_offset > 0 ? 1 : 0;
+        const size_t dropped = queue.size() - keep;
+        queue.erase(queue.begin() + keep, queue.end());
+        frames_dropped += dropped;
+        drops_since_send += (uint32_t)dropped;
+        last_sequence = 0;
+        return dropped;
+    }
+
+    FlushResult Flush() {
+        while (!queue.empty()) {
+            const std::string& bytes = *queue.front();
+            int result = send(socket, bytes.data() + front_offset, static_cast<int>(bytes.size() - front_offset), 0);
+            if (result == SOCKET_ERROR) {
+                // A full socket buffer just means "later", not a disconnect
+                return WSAGetLastError() == WSAEWOULDBLOCK ? FlushResult::WouldBlock : FlushResult::Failed;
             }
-            
-            if (!send_successful || total_sent != data_size) {
-                // Client disconnected or send failed, remove from list
-                closesocket(*it);
-                it = client_sockets.erase(it);
-            } else {
-                ++it;  // Success, move to next client
+            front_offset += static_cast<size_t>(result);
+            if (front_offset == bytes.size()) {
+                queue.pop_front();
+                front_offset = 0;
+                drops_since_send = 0;
             }
         }
+        return FlushResult::Drained;
     }
+};
+
+struct BroadcastStats {
+    uint64_t frames_published;      // Frames handed over by the sim thread
+    uint64_t frames_skipped;        // Dropped before encoding (encoder behind)
+    uint64_t frames_dropped;        // Dropped from client queues (client behind)
+    uint64_t clients_evicted;       // Disconnected for not draining their queue
+    uint64_t clients_disconnected;  // Removed after a send error
+};
+
+// all_variables slots that changed since the previous Update() (base_sequence), shared by the JSON
+// and binary delta encodings. Compares bit patterns, so NaN <-> NaN is not a change.
+class FrameDeltaTracker {
+public:
+    static constexpr size_t VARIABLE_COUNT = (size_t)VariableIndex::VARIABLE_COUNT;
+    
+    uint32_t base_sequence;             // update_counter the changes apply to, 0 = no previous frame
+    uint32_t count;
+    uint16_t indices[VARIABLE_COUNT];
     
 private:
-    void ServerLoop() {
-        OutputDebugStringA("ServerLoop started\n");
-        
-        while (running) {
-            // Set timeout on accept to avoid infinite blocking
-            fd_set readfds;
-            FD_ZERO(&readfds);
-            FD_SET(server_socket, &readfds);
-            
-            struct timeval timeout;
-            timeout.tv_sec = 1;   // 1 second timeout
-            timeout.tv_usec = 0;
-            
-            int result = select(0, &readfds, NULL, NULL, &timeout);
-            
-            if (result > 0 && FD_ISSET(server_socket, &readfds)) {
-                // Accept new connection
-                SOCKET client_socket = accept(server_socket, nullptr, nullptr);
-                if (client_socket != INVALID_SOCKET && running) {
-                    u_long mode = 1;
-                    ioctlsocket(client_socket, FIONBIO, &mode);
-                    
-                    std::lock_guard<std::mutex> lock(clients_mutex);
-                    client_sockets.push_back(client_socket);
-                    OutputDebugStringA("Client connected\n");
+    uint32_t previous_sequence;
+    double previous[VARIABLE_COUNT];
+    
+public:
+    FrameDeltaTracker() : base_sequence(0), count(0), indices(), previous_sequence(0), previous() {}
+    
+    // variables: the slots to track (nullptr = all of them)
+    void Update(const AeroflyFrameData& frame, const uint16_t* variables = nullptr, size_t variable_count = 0) {
+        count = 0;
+        if (!variables) {
+            for (size_t i = 0; i < VARIABLE_COUNT; ++i) {
+                if (memcmp(&previous[i], &frame.all_variables[i], sizeof(double)) != 0) {
+                    indices[count++] = (uint16_t)i;
                 }
             }
-            else if (result == SOCKET_ERROR) {
-                int error = WSAGetLastError();
-                if (error != WSAEINTR && running) {
-                    OutputDebugStringA("Error in select()\n");
-                    break;
+            memcpy(previous, frame.all_variables, sizeof(previous));
+        } else {
+            for (size_t n = 0; n < variable_count; ++n) {
+                const uint16_t i = variables[n];
+                if (memcmp(&previous[i], &frame.all_variables[i], sizeof(double)) != 0) {
+                    indices[count++] = i;
+                    previous[i] = frame.all_variables[i];
                 }
             }
-            // result == 0 = timeout, continue loop
         }
-        
-        OutputDebugStringA("ServerLoop finished\n");
+        base_sequence = previous_sequence;
+        previous_sequence = frame.update_counter;
     }
+};
+
+// Data-stream JSON field: pre-baked separator and key, then the frame member
+struct JsonNamedField {
+    const char* key;            // Separator and key, including any group opening/closing
+    size_t key_length;
+    double AeroflyFrameData::* field;
     
-    void CommandLoop(int command_port) {
-        OutputDebugStringA("CommandLoop started\n");
-        
-        // Create command server socket
-        SOCKET cmd_socket = socket(AF_INET, SOCK_STREAM, 0);
-        if (cmd_socket == INVALID_SOCKET) {
-            OutputDebugStringA("Failed to create command socket\n");
-            return;
+    template <size_t N>
+    constexpr JsonNamedField(const char (&text)[N], double AeroflyFrameData::* member)
+        : key(text), key_length(N - 1), field(member) {}
+};
+
+static constexpr JsonNamedField kJsonNamedFields[] = {
+    { ",\"aircraft\":{\"latitude\":", &AeroflyFrameData::latitude },
+    { ",\"longitude\":", &AeroflyFrameData::longitude },
+    { ",\"altitude\":", &AeroflyFrameData::altitude },
+    { ",\"pitch\":", &AeroflyFrameData::pitch },
+    { ",\"bank\":", &AeroflyFrameData::bank },
+    { ",\"heading\":", &AeroflyFrameData::true_heading },
+    { ",\"airspeed\":", &AeroflyFrameData::indicated_airspeed },
+    { ",\"ground_speed\":", &AeroflyFrameData::ground_speed },
+    { ",\"vertical_speed\":", &AeroflyFrameData::vertical_speed },
+    { ",\"angle_of_attack\":", &AeroflyFrameData::angle_of_attack },
+    { ",\"on_ground\":", &AeroflyFrameData::on_ground },
+    { "},\"controls\":{\"pitch_input\":", &AeroflyFrameData::pitch_input },
+    { ",\"roll_input\":", &AeroflyFrameData::roll_input },
+    { ",\"yaw_input\":", &AeroflyFrameData::yaw_input },
+    { ",\"throttle\":", &AeroflyFrameData::throttle_position },
+    { ",\"flaps\":", &AeroflyFrameData::flaps_position },
+    { ",\"gear\":", &AeroflyFrameData::gear_position },
+    { "},\"navigation\":{\"com1_frequency\":", &AeroflyFrameData::com1_frequency },
+    { ",\"com1_standby\":", &AeroflyFrameData::com1_standby_frequency },
+    { ",\"nav1_frequency\":", &AeroflyFrameData::nav1_frequency },
+    { ",\"nav1_course\":", &AeroflyFrameData::nav1_selected_course },
+    { "},\"autopilot\":{\"engaged\":", &AeroflyFrameData::ap_engaged },
+    { ",\"selected_airspeed\":", &AeroflyFrameData::ap_selected_airspeed },
+    { ",\"selected_heading\":", &AeroflyFrameData::ap_selected_heading },
+    { ",\"selected_altitude\":", &AeroflyFrameData::ap_selected_altitude },
+    { "},\"performance\":{\"vs0\":", &AeroflyFrameData::vs0_speed },
+    { ",\"vs1\":", &AeroflyFrameData::vs1_speed },
+    { ",\"vfe\":", &AeroflyFrameData::vfe_speed },
+    { ",\"vno\":", &AeroflyFrameData::vno_speed },
+    { ",\"vne\":", &AeroflyFrameData::vne_speed },
+};
+
+// Data-stream JSON encoder: writes each frame into a reused buffer with std::to_chars. Keys and
+// separators are pre-baked, and the output is byte-identical to std::fixed << setprecision(6).
+class JsonFrameEncoder {
+private:
+    static constexpr size_t NAMED_COUNT = sizeof(kJsonNamedFields) / sizeof(kJsonNamedFields[0]);
+    static constexpr size_t VARIABLE_COUNT = (size_t)VariableIndex::VARIABLE_COUNT;
+    
+    static constexpr size_t MAX_NUMBER_TEXT = 320;  // "%.6f" of -DBL_MAX is 317 characters
+    static constexpr size_t CACHED_TEXT = 24;       // Fits any |value| < 1e16
+    
+    std::string buffer;
+    size_t length;
+    
+    // Sanitized numbers of the frame being encoded: named fields, then all_variables
+    double values[NAMED_COUNT + VARIABLE_COUNT];
+    double delta_values[VARIABLE_COUNT + StreamFrame::MAX_DYNAMIC]; // Sanitized values of EncodeChanges()
+    
+    // Formatted all_variables; only the entries in the frame's change journal are reformatted,
+    // unless frames were skipped since variable_text_frame. Length 0 = too long to cache.
+    char variable_text[VARIABLE_COUNT][CACHED_TEXT];
+    uint8_t variable_text_length[VARIABLE_COUNT];
+    uint32_t variable_text_frame;
+    
+public:
+    JsonFrameEncoder() : buffer(16384, '\0'), length(0), values(), delta_values(), variable_text(), variable_text_length(),
+                         variable_text_frame(0) {}
+    
+    // Newline-terminated JSON object for the frame; valid until the next Encode(). use_cache = false
+    // formats every all_variables value instead of using (and updating) the per-frame text cache.
+    std::string_view Encode(const AeroflyFrameData& frame, bool use_cache = true) {
+        for (size_t i = 0; i < NAMED_COUNT; ++i) {
+            values[i] = frame.*kJsonNamedFields[i].field;
+        }
+        memcpy(values + NAMED_COUNT, frame.all_variables, sizeof(frame.all_variables));
+        // CRITICAL: Protect against NaN/Infinity (one pass over every number of the frame)
+        SanitizeFinite(values, NAMED_COUNT + VARIABLE_COUNT);
+        if (use_cache) {
+            RefreshVariableText(frame);
         }
         
-        int opt = 1;
-        setsockopt(cmd_socket, SOL_SOCKET, SO_REUSEADDR, (char*)&opt, sizeof(opt));
-        
-        sockaddr_in cmd_addr;
-        cmd_addr.sin_family = AF_INET;
-        cmd_addr.sin_addr.s_addr = INADDR_ANY;
-        cmd_addr.sin_port = htons(command_port);
+        length = 0;
+        AppendLiteral("{\"timestamp\":");
+        AppendInteger(frame.timestamp_us);
+        AppendLiteral(",\"data_valid\":");
+        AppendInteger(frame.data_valid);
+        AppendLiteral(",\"update_counter\":");
+        AppendInteger(frame.update_counter);
         
-        if (bind(cmd_socket, (sockaddr*)&cmd_addr, sizeof(cmd_addr)) == SOCKET_ERROR ||
-            listen(cmd_socket, 5) == SOCKET_ERROR) {
-            OutputDebugStringA("Failed to bind/listen command socket\n");
-            closesocket(cmd_socket);
-            return;
+        for (size_t i = 0; i < NAMED_COUNT; ++i) {
+            Append(kJsonNamedFields[i].key, kJsonNamedFields[i].key_length);
+            AppendFixed(values[i]);
         }
         
-        while (running) {
-            // Use select with timeout instead of blocking accept
-            fd_set readfds;
-            FD_ZERO(&readfds);
-            FD_SET(cmd_socket, &readfds);
-            
-            struct timeval timeout;
-            timeout.tv_sec = 1;   // 1 second timeout
-            timeout.tv_usec = 0;
-            
-            int result = select(0, &readfds, NULL, NULL, &timeout);
-            
-            if (result > 0 && FD_ISSET(cmd_socket, &readfds)) {
-                SOCKET client = accept(cmd_socket, nullptr, nullptr);
-                if (client != INVALID_SOCKET && running) {
-                    // Handle command from client
-                    char buffer[1024];
-                    int bytes_received = recv(client, buffer, sizeof(buffer) - 1, 0);
-                    if (bytes_received > 0) {
-                        buffer[bytes_received] = '\0';
-                        ProcessCommand(std::string(buffer));
-                        OutputDebugStringA("Command processed\n");
-                    }
-                    closesocket(client);
-                }
-            }
-            else if (result == SOCKET_ERROR) {
-                int error = WSAGetLastError();
-                if (error != WSAEINTR && running) {
-                    OutputDebugStringA("Error in command select()\n");
-                    break;
-                }
+        AppendLiteral("},\"all_variables\":[");
+        for (size_t i = 0; i < VARIABLE_COUNT; ++i) {
+            if (i > 0) AppendLiteral(",");
+            if (use_cache && variable_text_length[i] != 0) {
+                Append(variable_text[i], variable_text_length[i]);
+            } else {
+                AppendFixed(values[NAMED_COUNT + i]);
             }
-            // result == 0 = timeout, continue loop
-        }
-        
-        OutputDebugStringA("Closing command socket\n");
-        closesocket(cmd_socket);
-        OutputDebugStringA("CommandLoop finished\n");
-    }
-    
-    std::string CreateDataJSON(const AeroflyBridgeData* data) {
-        std::ostringstream json;
-        
-        // CRITICAL FIX 1: Set fixed precision to prevent scientific notation (1e+08)
-        json << std::fixed << std::setprecision(6);
-        
-        json << "{";
-        json << "\"timestamp\":" << data->timestamp_us << ",";
-        json << "\"data_valid\":" << data->data_valid << ",";
-        json << "\"update_counter\":" << data->update_counter << ",";
-        
-        // Aircraft data with NaN/Infinity protection
-        json << "\"aircraft\":{";
-        json << "\"latitude\":" << (std::isfinite(data->latitude) ? data->latitude : 0.0) << ",";
-        json << "\"longitude\":" << (std::isfinite(data->longitude) ? data->longitude : 0.0) << ",";
-        json << "\"altitude\":" << (std::isfinite(data->altitude) ? data->altitude : 0.0) << ",";
-        json << "\"pitch\":" << (std::isfinite(data->pitch) ? data->pitch : 0.0) << ",";
-        json << "\"bank\":" << (std::isfinite(data->bank) ? data->bank : 0.0) << ",";
-        json << "\"heading\":" << (std::isfinite(data->true_heading) ? data->true_heading : 0.0) << ",";
-        json << "\"airspeed\":" << (std::isfinite(data->indicated_airspeed) ? data->indicated_airspeed : 0.0) << ",";
-        json << "\"ground_speed\":" << (std::isfinite(data->ground_speed) ? data->ground_speed : 0.0) << ",";
-        json << "\"vertical_speed\":" << (std::isfinite(data->vertical_speed) ? data->vertical_speed : 0.0) << ",";
-        json << "\"angle_of_attack\":" << (std::isfinite(data->angle_of_attack) ? data->angle_of_attack : 0.0) << ",";
-        json << "\"on_ground\":" << (std::isfinite(data->on_ground) ? data->on_ground : 0.0);
-        json << "},";  // No trailing comma
-        
-        // Controls
-        json << "\"controls\":{";
-        json << "\"pitch_input\":" << (std::isfinite(data->pitch_input) ? data->pitch_input : 0.0) << ",";
-        json << "\"roll_input\":" << (std::isfinite(data->roll_input) ? data->roll_input : 0.0) << ",";
-        json << "\"yaw_input\":" << (std::isfinite(data->yaw_input) ? data->yaw_input : 0.0) << ",";
-        json << "\"throttle\":" << (std::isfinite(data->throttle_position) ? data->throttle_position : 0.0) << ",";
-        json << "\"flaps\":" << (std::isfinite(data->flaps_position) ? data->flaps_position : 0.0) << ",";
-        json << "\"gear\":" << (std::isfinite(data->gear_position) ? data->gear_position : 0.0);
-        json << "},";
-        
-        // Navigation
-        json << "\"navigation\":{";
-        json << "\"com1_frequency\":" << (std::isfinite(data->com1_frequency) ? data->com1_frequency : 0.0) << ",";
-        json << "\"com1_standby\":" << (std::isfinite(data->com1_standby_frequency) ? data->com1_standby_frequency : 0.0) << ",";
-        json << "\"nav1_frequency\":" << (std::isfinite(data->nav1_frequency) ? data->nav1_frequency : 0.0) << ",";
-        json << "\"nav1_course\":" << (std::isfinite(data->nav1_selected_course) ? data->nav1_selected_course : 0.0);
-        json << "},";
-        
-        // Autopilot
-        json << "\"autopilot\":{";
-        json << "\"engaged\":" << (std::isfinite(data->ap_engaged) ? data->ap_engaged : 0.0) << ",";
-        json << "\"selected_airspeed\":" << (std::isfinite(data->ap_selected_airspeed) ? data->ap_selected_airspeed : 0.0) << ",";
-        json << "\"selected_heading\":" << (std::isfinite(data->ap_selected_heading) ? data->ap_selected_heading : 0.0) << ",";
-        json << "\"selected_altitude\":" << (std::isfinite(data->ap_selected_altitude) ? data->ap_selected_altitude : 0.0);
-        json << "},";
-        
-        // Performance speeds
-        json << "\"performance\":{";
-        json << "\"vs0\":" << (std::isfinite(data->vs0_speed) ? data->vs0_speed : 0.0) << ",";
-        json << "\"vs1\":" << (std::isfinite(data->vs1_speed) ? data->vs1_speed : 0.0) << ",";
-        json << "\"vfe\":" << (std::isfinite(data->vfe_speed) ? data->vfe_speed : 0.0) << ",";
-        json << "\"vno\":" << (std::isfinite(data->vno_speed) ? data->vno_speed : 0.0) << ",";
-        json << "\"vne\":" << (std::isfinite(data->vne_speed) ? data->vne_speed : 0.0);
-        json << "},";
-        
-        // All variables array (with NaN/Infinity protection)
-        json << "\"all_variables\":[";
-        for (int i = 0; i < (int)VariableIndex::VARIABLE_COUNT; ++i) {
-            if (i > 0) json << ",";
-            double value = data->all_variables[i];
-            // CRITICAL: Protect against NaN/Infinity in array
-            json << (std::isfinite(value) ? value : 0.0);
         }
-        json << "]";  // No trailing comma
-        
-        json << "}";  // Close main JSON object
         
-        // CRITICAL FIX 2: Add newline separator to prevent JSON concatenation
-        json << "\n";
+        // Newline separator prevents JSON concatenation on the stream
+        AppendLiteral("]}\n");
+        return std::string_view(buffer.data(), length);
+    }
+    
+    // Delta or subscription frame:
+    // {"timestamp":..,"data_valid":..,"update_counter":..,"base":..,"changes":[[index,value],...],"dynamic":{"name":value,...}}
+    // base 0 = the complete set of subscribed values. "dynamic" is only present with dynamic_count > 0;
+    // dynamic_keys are pre-baked "\"name\":" strings. Valid until the next Encode()/EncodeChanges().
+    std::string_view EncodeChanges(const AeroflyFrameData& frame, uint32_t base_sequence, const uint16_t* indices,
+                                   uint32_t count, const std::string* dynamic_keys = nullptr,
+                                   const double* dynamic_values = nullptr, uint32_t dynamic_count = 0) {
+        dynamic_count = (std::min)(dynamic_count, StreamFrame::MAX_DYNAMIC);
+        for (uint32_t n = 0; n < count; n++) {
+            delta_values[n] = frame.all_variables[indices[n]];
+        }
+        for (uint32_t n = 0; n < dynamic_count; n++) {
+            delta_values[count + n] = dynamic_values[n];
+        }
+        SanitizeFinite(delta_values, count + dynamic_count);
         
-        return json.str();
+        length = 0;
+        AppendLiteral("{\"timestamp\":");
+        AppendInteger(frame.timestamp_us);
+        AppendLiteral(",\"data_valid\":");
+        AppendInteger(frame.data_valid);
+        AppendLiteral(",\"update_counter\":");
+        AppendInteger(frame.update_counter);
+        AppendLiteral(",\"base\":");
+        AppendInteger(base_sequence);
+        AppendLiteral(",\"changes\":[");
+        for (uint32_t n = 0; n < count; n++) {
+            if (n > 0) AppendLiteral(",");
+            AppendLiteral("[");
+            AppendInteger(indices[n]);
+            AppendLiteral(",");
+            AppendFixed(delta_values[n]);
+            AppendLiteral("]");
+        }
+        AppendLiteral("]");
+        if (dynamic_count > 0) {
+            AppendLiteral(",\"dynamic\":{");
+            for (uint32_t n = 0; n < dynamic_count; n++) {
+                if (n > 0) AppendLiteral(",");
+                Append(dynamic_keys[n].data(), dynamic_keys[n].size());
+                AppendFixed(delta_values[count + n]);
+            }
+            AppendLiteral("}");
+        }
+        AppendLiteral("}\n");
+        return std::string_view(buffer.data(), length);
+    }
+    
+private:
+    // x - x is 0 only for finite x; branchless so the loop vectorizes (requires precise FP, not /fp:fast)
+    static void SanitizeFinite(double* data, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            data[i] = (data[i] - data[i] == 0.0) ? data[i] : 0.0;
+        }
+    }
+    
+    void RefreshVariableText(const AeroflyFrameData& frame) {
+        if (variable_text_frame != 0 && frame.update_counter == variable_text_frame) {
+            return;     // Same frame encoded again (several full subscriptions)
+        }
+        if (variable_text_frame != 0 && frame.update_counter == variable_text_frame + 1) {
+            for (uint32_t n = 0; n < frame.changed_count; n++) {
+                FormatVariableText(frame.changed_indices[n]);
+            }
+        } else {
+            for (size_t i = 0; i < VARIABLE_COUNT; ++i) {
+                FormatVariableText(i);
+            }
+        }
+        variable_text_frame = frame.update_counter;
+    }
+    
+    void FormatVariableText(size_t index) {
+        char* text = variable_text[index];
+        const std::to_chars_result result =
+            std::to_chars(text, text + CACHED_TEXT, values[NAMED_COUNT + index], std::chars_format::fixed, 6);
+        variable_text_length[index] = result.ec == std::errc() ? (uint8_t)(result.ptr - text) : 0;
+    }
+    
+    char* Reserve(size_t count) {
+        if (length + count > buffer.size()) {
+            buffer.resize((std::max)(buffer.size() * 2, length + count));
+        }
+        return &buffer[length];
+    }
+    
+    void Append(const char* text, size_t count) {
+        memcpy(Reserve(count), text, count);
+        length += count;
+    }
+    
+    template <size_t N>
+    void AppendLiteral(const char (&text)[N]) {
+        Append(text, N - 1);
+    }
+    
+    template <typename T>
+    void AppendInteger(T value) {
+        char* out = Reserve(24);
+        length += std::to_chars(out, out + 24, value).ptr - out;
+    }
+    
+    void AppendFixed(double value) {
+        char* out = Reserve(MAX_NUMBER_TEXT);
+        length += std::to_chars(out, out + MAX_NUMBER_TEXT, value, std::chars_format::fixed, 6).ptr - out;
+    }
+};
+
+// Binary data-stream frame: this header, then value_count little-endian doubles. The doubles are
+// the Double/Vector3d fields of AeroflyFrameData in BRIDGE_FIELD_LIST order, ending with all_variables.
+// Delta and subscription frames (DELTA_MAGIC) carry value_count all_variables slots instead: uint32
+// base sequence (0 = complete set), uint32 dynamic count, value_count uint16 indices (zero-padded to
+// 8 bytes), value_count doubles, then the subscribed dynamic values as doubles.
+struct AeroflyStreamFrameHeader {
+    static constexpr uint32_t MAGIC = 0x53424641;       // "AFBS"
+    static constexpr uint32_t DELTA_MAGIC = 0x44424641; // "AFBD"
+    static constexpr uint16_t VERSION = 1;
+    
+    uint32_t frame_size;            // Bytes in this frame, header included
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;           // sizeof(AeroflyStreamFrameHeader)
+    uint32_t sequence;              // update_counter of the frame
+    uint64_t timestamp_us;
+    uint32_t data_valid;
+    uint16_t layout_version;        // AeroflyBridgeData::LAYOUT_VERSION the field order comes from
+    uint16_t value_count;           // Doubles after the header
+};
+
+static_assert(sizeof(AeroflyStreamFrameHeader) == 32, "Binary stream header is 32 bytes");
+
+// Byte ranges of AeroflyFrameData copied into a binary frame (adjacent fields merged), built from
+// kBridgeFields so the stream follows the shared memory layout without a second field list
+struct BinaryStreamLayout {
+    static constexpr uint32_t MAX_RUNS = 32;
+    
+    uint32_t run_offset[MAX_RUNS];
+    uint32_t run_size[MAX_RUNS];
+    uint32_t run_count;
+    uint32_t value_count;
+    
+    constexpr BinaryStreamLayout() : run_offset{}, run_size{}, run_count(0), value_count(0) {
+        for (const SchemaFieldInfo& field : kBridgeFields) {
+            if ((field.type != SchemaFieldType::Double && field.type != SchemaFieldType::Vector3d) ||
+                field.offset + field.size > sizeof(AeroflyFrameData)) {
+                continue;
+            }
+            if (run_count > 0 && run_offset[run_count - 1] + run_size[run_count - 1] == field.offset) {
+                run_size[run_count - 1] += field.size;
+            } else {
+                run_offset[run_count] = field.offset;
+                run_size[run_count] = field.size;
+                run_count++;
+            }
+            value_count += field.size / (uint32_t)sizeof(double);
+        }
     }
+};
+
+static constexpr BinaryStreamLayout kBinaryStreamLayout{};
+
+static_assert(kBinaryStreamLayout.run_count <= BinaryStreamLayout::MAX_RUNS, "Increase BinaryStreamLayout::MAX_RUNS");
+static_assert(kBinaryStreamLayout.value_count < 0x10000, "value_count must fit the binary stream header");
+
+// Data-stream binary encoder: header plus a handful of memcpy runs into a reused buffer
+// (x86/x64 Windows, so the doubles are already little-endian)
+class BinaryFrameEncoder {
+private:
+    static constexpr size_t VARIABLE_COUNT = (size_t)VariableIndex::VARIABLE_COUNT;
     
-    void ProcessCommand(const std::string& command) {
-        std::lock_guard<std::mutex> lock(command_mutex);
-        command_queue.push(command);
+    std::string buffer;
+    std::string delta_buffer;
+    
+    static AeroflyStreamFrameHeader MakeHeader(const AeroflyFrameData& frame, uint32_t magic, uint32_t frame_size,
+                                               uint32_t value_count) {
+        AeroflyStreamFrameHeader header;
+        header.frame_size = frame_size;
+        header.magic = magic;
+        header.version = AeroflyStreamFrameHeader::VERSION;
+        header.header_size = (uint16_t)sizeof(AeroflyStreamFrameHeader);
+        header.sequence = frame.update_counter;
+        header.timestamp_us = frame.timestamp_us;
+        header.data_valid = frame.data_valid;
+        header.layout_version = (uint16_t)AeroflyBridgeData::LAYOUT_VERSION;
+        header.value_count = (uint16_t)value_count;
+        return header;
     }
     
 public:
-    std::vector<std::string> GetPendingCommands() {
-        std::vector<std::string> commands;
-        std::lock_guard<std::mutex> lock(command_mutex);
+    BinaryFrameEncoder()
+        : buffer(sizeof(AeroflyStreamFrameHeader) + kBinaryStreamLayout.value_count * sizeof(double), '\0'),
+          delta_buffer(sizeof(AeroflyStreamFrameHeader) + 8 + VARIABLE_COUNT * (sizeof(uint16_t) + sizeof(double)) + 8 +
+                       StreamFrame::MAX_DYNAMIC * sizeof(double), '\0') {}
+    
+    // Frame bytes; valid until the next Encode()
+    std::string_view Encode(const AeroflyFrameData& frame) {
+        const AeroflyStreamFrameHeader header =
+            MakeHeader(frame, AeroflyStreamFrameHeader::MAGIC, (uint32_t)buffer.size(), kBinaryStreamLayout.value_count);
+        
+        char* out = &buffer[0];
+        memcpy(out, &header, sizeof(header));
+        out += sizeof(header);
         
-        while (!command_queue.empty()) {
-            commands.push_back(command_queue.front());
-            command_queue.pop();
+        const char* base = reinterpret_cast<const char*>(&frame);
+        for (uint32_t run = 0; run < kBinaryStreamLayout.run_count; ++run) {
+            memcpy(out, base + kBinaryStreamLayout.run_offset[run], kBinaryStreamLayout.run_size[run]);
+            out += kBinaryStreamLayout.run_size[run];
         }
+        return std::string_view(buffer.data(), buffer.size());
+    }
+    
+    // Delta or subscription frame bytes; valid until the next EncodeChanges()
+    std::string_view EncodeChanges(const AeroflyFrameData& frame, uint32_t base_sequence, const uint16_t* indices,
+                                   uint32_t count, const double* dynamic_values = nullptr, uint32_t dynamic_count = 0) {
+        dynamic_count = (std::min)(dynamic_count, StreamFrame::MAX_DYNAMIC);
+        const size_t index_bytes = (count * sizeof(uint16_t) + 7) & ~(size_t)7;
+        const size_t frame_size = sizeof(AeroflyStreamFrameHeader) + 8 + index_bytes +
+                                  (count + dynamic_count) * sizeof(double);
+        const AeroflyStreamFrameHeader header =
+            MakeHeader(frame, AeroflyStreamFrameHeader::DELTA_MAGIC, (uint32_t)frame_size, count);
         
-        return commands;
+        char* out = &delta_buffer[0];
+        memcpy(out, &header, sizeof(header));
+        out += sizeof(header);
+        const uint32_t base_and_dynamic[2] = { base_sequence, dynamic_count };
+        memcpy(out, base_and_dynamic, sizeof(base_and_dynamic));
+        out += sizeof(base_and_dynamic);
+        
+        memset(out, 0, index_bytes);
+        memcpy(out, indices, count * sizeof(uint16_t));
+        out += index_bytes;
+        for (uint32_t n = 0; n < count; n++) {
+            memcpy(out, &frame.all_variables[indices[n]], sizeof(double));
+            out += sizeof(double);
+        }
+        if (dynamic_count > 0) {
+            memcpy(out, dynamic_values, dynamic_count * sizeof(double));
+        }
+        return std::string_view(delta_buffer.data(), frame_size);
     }
+};
+
+// How a decimated subscription summarizes the frames of one RATE= window
+enum class StreamAggregation : uint8_t {
+    Last,       // Value of the frame that is sent
+    Mean,
+    Min,
+    Max,
+    Peak        // Value with the largest magnitude, sign kept (G-load, vertical speed at touchdown)
+};
+
+// Running per-variable aggregate of all_variables over a decimation window. Each frame is one
+// branchless pass over the 339 slots (vectorizable), so the cost does not grow with the window.
+// NaN samples are ignored by Min/Max/Peak (a NaN accumulator counts as empty, so a NaN first
+// sample is replaced by the next real one); a NaN makes the Mean NaN (sent as 0 in JSON).
+class VariableAggregator {
+private:
+    static constexpr size_t VARIABLE_COUNT = (size_t)VariableIndex::VARIABLE_COUNT;
     
-    int GetClientCount() const {
-        std::lock_guard<std::mutex> lock(clients_mutex);
-        return static_cast<int>(client_sockets.size());
+    StreamAggregation mode;
+    uint32_t samples;
+    double accumulator[VARIABLE_COUNT];
+    
+public:
+    explicit VariableAggregator(StreamAggregation aggregation) : mode(aggregation), samples(0), accumulator() {}
+    
+    void Add(const double* values) {
+        double* acc = accumulator;
+        if (samples == 0) {
+            memcpy(acc, values, sizeof(accumulator));
+        } else {
+            switch (mode) {
+                case StreamAggregation::Mean:
+                    for (size_t i = 0; i < VARIABLE_COUNT; ++i) acc[i] += values[i];
+                    break;
+                case StreamAggregation::Min:
+                    for (size_t i = 0; i < VARIABLE_COUNT; ++i) acc[i] = acc[i] != acc[i] || values[i] < acc[i] ? values[i] : acc[i];
+                    break;
+                case StreamAggregation::Max:
+                    for (size_t i = 0; i < VARIABLE_COUNT; ++i) acc[i] = acc[i] != acc[i] || values[i] > acc[i] ? values[i] : acc[i];
+                    break;
+                case StreamAggregation::Peak:
+                    for (size_t i = 0; i < VARIABLE_COUNT; ++i) acc[i] = acc[i] != acc[i] || fabs(values[i]) > fabs(acc[i]) ? values[i] : acc[i];
+                    break;
+                case StreamAggregation::Last:
+                    memcpy(acc, values, sizeof(accumulator));
+                    break;
+            }
+        }
+        samples++;
+    }
+    
+    // Writes the window's aggregate into frame (all_variables and the Double named fields bound to
+    // them) and starts a new window; frame keeps its own values if nothing was added
+    void Emit(AeroflyFrameData& frame) {
+        if (samples == 0) return;
+        if (mode == StreamAggregation::Mean) {
+            const double scale = 1.0 / samples;
+            for (size_t i = 0; i < VARIABLE_COUNT; ++i) frame.all_variables[i] = accumulator[i] * scale;
+        } else {
+            memcpy(frame.all_variables, accumulator, sizeof(accumulator));
+        }
+        char* base = reinterpret_cast<char*>(&frame);
+        for (const NamedFieldBinding& binding : kNamedFieldBindings) {
+            if (binding.type == NamedFieldType::Double) {
+                memcpy(base + binding.offset, &frame.all_variables[(int)binding.index], sizeof(double));
+            }
+        }
+        samples = 0;
+    }
+};
+
+enum StreamEncoding : int { STREAM_JSON = 0, STREAM_DELTA = 1, STREAM_BINARY = 2, STREAM_ENCODING_COUNT = 4 };
+
+// Data-stream subscription: which values a client receives and how often. Clients with equal
+// subscriptions share one instance, so a frame is encoded at most once per subscription and encoding.
+struct StreamSubscription {
+    static constexpr uint32_t KEYFRAME_INTERVAL = 120;  // Delta keyframe every N frames sent (~2 s at 60 Hz)
+    static constexpr double MIN_RATE_HZ = 0.01;         // Lower RATE= values are raised to this (one frame per 100 s)
+    
+    bool all_variables;                     // Full frames (no VARS= in the handshake)
+    std::vector<uint16_t> variables;        // Sorted VariableIndex values
+    std::vector<uint16_t> dynamic;          // Positions in StreamFrame::dynamic_values
+    std::vector<uint32_t> dynamic_slots;    // dynamic_values slot behind each position, same order as dynamic
+    std::vector<std::string> dynamic_keys;  // Pre-baked "\"name\":" JSON keys, same order as dynamic
+    uint64_t interval_us;                   // Minimum time between frames, 0 = every frame
+    StreamAggregation aggregation;          // AGG=, only with interval_us != 0
+    
+    // Encoder thread only
+    std::unique_ptr<VariableAggregator> aggregator;     // Set when aggregation != Last
+    std::unique_ptr<AeroflyFrameData> aggregated;       // Frame sent instead of the sim frame when aggregating
+    FrameDeltaTracker delta;                // Changes since the previous frame sent for this subscription
+    uint64_t last_sent_us;
+    uint32_t frames_sent;
+    bool due;                               // Frame being encoded is sent to this subscription
+    bool keyframe_due;
+    bool needed[STREAM_ENCODING_COUNT];
+    EncodedFrame encoded[STREAM_ENCODING_COUNT];
+    
+    StreamSubscription() : all_variables(true), interval_us(0), aggregation(StreamAggregation::Last), last_sent_us(0),
+                           frames_sent(0), due(false), keyframe_due(false), needed() {}
+    
+    bool SameAs(const StreamSubscription& other) const {
+        return all_variables == other.all_variables && variables == other.variables &&
+               dynamic == other.dynamic && interval_us == other.interval_us && aggregation == other.aggregation;
+    }
+    
+    // Frame to encode once due: the sim frame, or the aggregate of the window it closes
+    const AeroflyFrameData& CloseWindow(const AeroflyFrameData& frame) {
+        if (!aggregator) return frame;
+        memcpy(aggregated.get(), &frame, sizeof(AeroflyFrameData));
+        aggregator->Emit(*aggregated);
+        return *aggregated;
+    }
+    
+    // Rate limit with 10% slack, so RATE=30 on a 60 Hz sim sends every other frame
+    bool IsDue(uint64_t timestamp_us) const {
+        if (interval_us == 0 || frames_sent == 0 || timestamp_us < last_sent_us) return true;
+        return (timestamp_us - last_sent_us) * 10 >= interval_us * 9;
     }
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-// COMMAND PROCESSOR - Bidirectional Commands
+// NETWORK REACTOR - Socket multiplexing for the TCP server
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-class EnhancedCommandProcessor {
-    private:
-        VariableMapper mapper;
-        HybridVariableManager* hybrid_manager;
+// Readiness poller over a set of sockets, rebuilt by the caller before each Wait().
+// WSAPoll backend: the bridge is a Windows DLL, and WSAPoll has no FD_SETSIZE limit.
+class SocketPoller {
+public:
+    enum : uint32_t { READABLE = 1, WRITABLE = 2, FAILED = 4 };
+
+private:
+    std::vector<WSAPOLLFD> fds;
+
+public:
+    void Clear() { fds.clear(); }
+
+    // INVALID_SOCKET entries keep their position but are never reported
+    void Add(SOCKET socket, uint32_t interest) {
+        WSAPOLLFD fd;
+        fd.fd = socket;
+        fd.events = (SHORT)(((interest & READABLE) ? POLLRDNORM : 0) | ((interest & WRITABLE) ? POLLWRNORM : 0));
+        fd.revents = 0;
+        fds.push_back(fd);
+    }
+
+    // Number of ready sockets, 0 on timeout, SOCKET_ERROR on failure (timeout_ms -1 = infinite)
+    int Wait(int timeout_ms) {
+        return WSAPoll(fds.data(), (ULONG)fds.size(), timeout_ms);
+    }
+
+    uint32_t Events(size_t index) const {
+        if (index >= fds.size() || fds[index].fd == INVALID_SOCKET) return 0;
+        const SHORT revents = fds[index].revents;
+        return ((revents & POLLRDNORM) ? READABLE : 0u) |
+               ((revents & POLLWRNORM) ? WRITABLE : 0u) |
+               ((revents & (POLLERR | POLLHUP | POLLNVAL)) ? FAILED : 0u);
+    }
+};
+
+// Loopback UDP socket connected to itself: Signal() makes it readable, which wakes a thread
+// blocked in SocketPoller::Wait() (new frames to send, shutdown).
+class ReactorWakeup {
+private:
+    SOCKET socket_handle;
+
+public:
+    ReactorWakeup() : socket_handle(INVALID_SOCKET) {}
+
+    bool Open() {
+        socket_handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (socket_handle == INVALID_SOCKET) return false;
+
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        int addr_len = sizeof(addr);
+        u_long mode = 1;
+        if (bind(socket_handle, (sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR ||
+            getsockname(socket_handle, (sockaddr*)&addr, &addr_len) == SOCKET_ERROR ||
+            connect(socket_handle, (sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR ||
+            ioctlsocket(socket_handle, FIONBIO, &mode) == SOCKET_ERROR) {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void Signal() {
+        if (socket_handle != INVALID_SOCKET) {
+            const char byte = 1;
+            send(socket_handle, &byte, 1, 0);   // A full buffer already guarantees a wakeup
+        }
+    }
+
+    void Drain() {
+        char buffer[64];
+        while (recv(socket_handle, buffer, sizeof(buffer), 0) > 0) {
+        }
+    }
+
+    void Close() {
+        if (socket_handle != INVALID_SOCKET) {
+            closesocket(socket_handle);
+            socket_handle = INVALID_SOCKET;
+        }
+    }
+
+    SOCKET Socket() const { return socket_handle; }
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// COMMAND PARSER - JSON command objects
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// One command, as views into the received text: valid only as long as that text is
+struct CommandData {
+    std::string_view variable_name;
+    std::string_view event_type;
+    std::string_view qualifier;
+    double value;
+    uint32_t handle;                    // "handle" instead of "variable", see kDynamicHandleFlag
+    bool has_handle;
+    bool is_event_command;              // "event" or "qualifier" present
+    
+    CommandData() : value(0.0), handle(kInvalidHandle), has_handle(false), is_event_command(false) {}
+};
+
+enum class CommandParseError : uint8_t {
+    None,
+    ExpectedObject,                     // Not a JSON object
+    ExpectedKey,
+    ExpectedColon,
+    ExpectedSeparator,                  // ',' or the closing bracket
+    InvalidString,                      // Unterminated, raw control character or bad escape
+    EscapedString,                      // Escapes in variable/event/qualifier (views are never unescaped)
+    InvalidNumber,                      // Not a JSON number, or not a finite double
+    InvalidValue,                       // Not a JSON value, or the wrong type for a known key
+    TooDeep,
+    MissingVariable,                    // Neither "variable" nor "handle"
+    MixedBatch,                         // "commands" together with a command's own fields
+    TrailingData,
+};
+
+inline const char* CommandParseErrorName(CommandParseError error) {
+    switch (error) {
+        case CommandParseError::None:              return "none";
+        case CommandParseError::ExpectedObject:    return "expected object";
+        case CommandParseError::ExpectedKey:       return "expected key";
+        case CommandParseError::ExpectedColon:     return "expected ':'";
+        case CommandParseError::ExpectedSeparator: return "expected ',' or closing bracket";
+        case CommandParseError::InvalidString:     return "invalid string";
+        case CommandParseError::EscapedString:     return "escaped string in command field";
+        case CommandParseError::InvalidNumber:     return "invalid number";
+        case CommandParseError::InvalidValue:      return "invalid value";
+        case CommandParseError::TooDeep:           return "nesting too deep";
+        case CommandParseError::MissingVariable:   return "missing variable";
+        case CommandParseError::MixedBatch:        return "batch mixed with command fields";
+        case CommandParseError::TrailingData:      return "trailing data";
+    }
+    return "unknown";
+}
+
+// Single-pass JSON tokenizer over a command message. Never allocates or throws (beyond growing the
+// caller's batch vector); the first error stops it.
+// Unknown keys are validated and skipped, so a key name inside a string value can't be mistaken
+// for a field.
+class CommandParser {
+public:
+    static constexpr int MAX_DEPTH = 32;
+    
+private:
+    const char* cursor;
+    const char* end;
+    
+public:
+    explicit CommandParser(std::string_view text) : cursor(text.data()), end(text.data() + text.size()) {}
+    
+    // Parses a complete message holding exactly one command object
+    static CommandParseError Parse(std::string_view text, CommandData& command) {
+        CommandParser parser(text);
+        CommandParseError error = parser.ParseCommand(command);
+        if (error == CommandParseError::None) {
+            parser.SkipWhitespace();
+            if (!parser.AtEnd()) error = CommandParseError::TrailingData;
+        }
+        return error;
+    }
+    
+    // Parses a complete message: one command object, an array of them, or a batch object
+    // {"commands": [...], "same_frame": true}. Replaces `commands` with the message's commands in
+    // order; an error anywhere rejects the whole message. same_frame: the batch must not be split
+    // across sim frames.
+    static CommandParseError ParseMessage(std::string_view text, std::vector<CommandData>& commands, bool& same_frame) {
+        CommandParser parser(text);
+        commands.clear();
+        same_frame = false;
         
-        // Command statistics
-        mutable std::mutex stats_mutex;
-        std::unordered_map<std::string, int> command_stats;
+        CommandParseError error;
+        parser.SkipWhitespace();
+        if (!parser.AtEnd() && *parser.cursor == '[') {
+            error = parser.ParseCommandArray(commands);
+        } else {
+            CommandBatch batch{ &commands, false, false };
+            CommandData command;
+            error = parser.ParseCommand(command, &batch);
+            if (error == CommandParseError::None) {
+                if (!batch.present) commands.push_back(command);
+                same_frame = batch.same_frame;
+            }
+        }
+        if (error == CommandParseError::None) {
+            parser.SkipWhitespace();
+            if (!parser.AtEnd()) error = CommandParseError::TrailingData;
+        }
+        if (error != CommandParseError::None) {
+            commands.clear();
+        }
+        return error;
+    }
+    
+    // {"resolve": ["name", ...]}: replaces `names` with the requested names in order. is_resolve
+    // tells a resolve request (valid or not) from a command.
+    static CommandParseError ParseResolve(std::string_view text, std::vector<std::string_view>& names, bool& is_resolve) {
+        CommandParser parser(text);
+        names.clear();
+        is_resolve = false;
         
-    public:
-        EnhancedCommandProcessor() : hybrid_manager(nullptr) {}
+        CommandParseError error = parser.ParseResolveObject(names, is_resolve);
+        if (error == CommandParseError::None) {
+            parser.SkipWhitespace();
+            if (!parser.AtEnd()) error = CommandParseError::TrailingData;
+        }
+        return error;
+    }
+    
+    bool AtEnd() const { return cursor == end; }
+    
+    void SkipWhitespace() {
+        while (cursor != end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r' || *cursor == '\n')) ++cursor;
+    }
+    
+    // Batch fields of a top-level object, see ParseMessage()
+    struct CommandBatch {
+        std::vector<CommandData>* commands;
+        bool same_frame;
+        bool present;                   // Had a "commands" array
+    };
+    
+    // {"variable": "...", "value": n, "event": "...", "qualifier": "..."} in any order.
+    // batch: also accept "commands"/"same_frame" (top level only, batches don't nest)
+    CommandParseError ParseCommand(CommandData& command, CommandBatch* batch = nullptr) {
+        command = CommandData();
+        SkipWhitespace();
+        if (cursor == end || *cursor != '{') return CommandParseError::ExpectedObject;
+        ++cursor;
         
-        void SetHybridManager(HybridVariableManager* manager) {
-            hybrid_manager = manager;
-            HybridLogToFile("EnhancedCommandProcessor: Hybrid manager connected");
-            OutputDebugStringA("Enhanced CommandProcessor: Hybrid manager connected\n");
+        SkipWhitespace();
+        if (cursor != end && *cursor == '}') {
+            ++cursor;
+            return CommandParseError::MissingVariable;
         }
         
-        std::vector<tm_external_message> ProcessCommands(const std::vector<std::string>& commands) {
-            std::vector<tm_external_message> messages;
+        for (;;) {
+            std::string_view key;
+            bool escaped = false;
+            SkipWhitespace();
+            if (cursor == end || *cursor != '"') return CommandParseError::ExpectedKey;
+            CommandParseError error = ParseString(key, escaped);
+            if (error != CommandParseError::None) return error;
             
-            for (const auto& command : commands) {
-                auto msg = ParseEnhancedCommand(command);
-                if (msg.GetDataType() != tm_msg_data_type::None) {
-                    messages.push_back(msg);
-                    
-                    // Update statistics
-                    UpdateCommandStats(command);
+            SkipWhitespace();
+            if (cursor == end || *cursor != ':') return CommandParseError::ExpectedColon;
+            ++cursor;
+            SkipWhitespace();
+            
+            std::string_view* text_field = nullptr;
+            if (!escaped) {
+                if (key == "variable") {
+                    text_field = &command.variable_name;
+                } else if (key == "event") {
+                    text_field = &command.event_type;
+                    command.is_event_command = true;
+                } else if (key == "qualifier") {
+                    text_field = &command.qualifier;
+                    command.is_event_command = true;
+                }
+            }
+            
+            if (text_field) {
+                if (cursor == end || *cursor != '"') return CommandParseError::InvalidValue;
+                error = ParseString(*text_field, escaped);
+                if (error == CommandParseError::None && escaped) error = CommandParseError::EscapedString;
+            } else if (!escaped && key == "value") {
+                error = ParseNumericValue(command.value);
+            } else if (!escaped && key == "handle") {
+                double handle = -1.0;
+                error = cursor != end && IsDigit(*cursor) ? ParseNumber(handle) : CommandParseError::InvalidValue;
+                // Range first (digits only, so never negative): the cast is only defined below kInvalidHandle
+                if (error == CommandParseError::None && (handle >= kInvalidHandle || handle != (double)(uint32_t)handle)) {
+                    error = CommandParseError::InvalidValue;
                 }
+                if (error == CommandParseError::None) {
+                    command.handle = (uint32_t)handle;
+                    command.has_handle = true;
+                }
+            } else if (batch && !escaped && key == "commands") {
+                error = cursor != end && *cursor == '[' ? ParseCommandArray(*batch->commands) : CommandParseError::InvalidValue;
+                batch->present = true;
+            } else if (batch && !escaped && key == "same_frame") {
+                double flag = 0.0;
+                error = ParseNumericValue(flag);
+                batch->same_frame = flag != 0.0;
+            } else {
+                error = SkipValue(0);
             }
+            if (error != CommandParseError::None) return error;
             
-            return messages;
+            SkipWhitespace();
+            if (cursor == end) return CommandParseError::ExpectedSeparator;
+            if (*cursor == '}') {
+                ++cursor;
+                break;
+            }
+            if (*cursor != ',') return CommandParseError::ExpectedSeparator;
+            ++cursor;
         }
         
-        // Get command processing statistics
-        std::vector<std::string> GetCommandStats() const {
-            std::lock_guard<std::mutex> lock(stats_mutex);
-            std::vector<std::string> stats;
+        if (batch && batch->present) {
+            const bool mixed = !command.variable_name.empty() || command.has_handle || !command.event_type.empty() ||
+                               !command.qualifier.empty();
+            return mixed ? CommandParseError::MixedBatch : CommandParseError::None;
+        }
+        return command.variable_name.empty() && !command.has_handle ? CommandParseError::MissingVariable
+                                                                    : CommandParseError::None;
+    }
+    
+    CommandParseError ParseResolveObject(std::vector<std::string_view>& names, bool& is_resolve) {
+        SkipWhitespace();
+        if (cursor == end || *cursor != '{') return CommandParseError::ExpectedObject;
+        ++cursor;
+        SkipWhitespace();
+        if (cursor != end && *cursor == '}') {
+            ++cursor;
+            return CommandParseError::None;
+        }
+        
+        for (;;) {
+            std::string_view key;
+            bool escaped = false;
+            SkipWhitespace();
+            if (cursor == end || *cursor != '"') return CommandParseError::ExpectedKey;
+            CommandParseError error = ParseString(key, escaped);
+            if (error != CommandParseError::None) return error;
+            SkipWhitespace();
+            if (cursor == end || *cursor != ':') return CommandParseError::ExpectedColon;
+            ++cursor;
+            SkipWhitespace();
             
-            for (const auto& pair : command_stats) {
-                stats.push_back(pair.first + ": " + std::to_string(pair.second) + " times");
+            if (!escaped && key == "resolve") {
+                is_resolve = true;
+                if (cursor == end || *cursor != '[') return CommandParseError::InvalidValue;
+                ++cursor;
+                SkipWhitespace();
+                if (cursor != end && *cursor == ']') {
+                    ++cursor;
+                } else {
+                    for (;;) {
+                        std::string_view name;
+                        SkipWhitespace();
+                        if (cursor == end || *cursor != '"') return CommandParseError::InvalidValue;
+                        error = ParseString(name, escaped);
+                        if (error != CommandParseError::None) return error;
+                        names.push_back(name);      // Escaped names stay escaped and won't resolve
+                        SkipWhitespace();
+                        if (cursor == end) return CommandParseError::ExpectedSeparator;
+                        if (*cursor == ']') {
+                            ++cursor;
+                            break;
+                        }
+                        if (*cursor != ',') return CommandParseError::ExpectedSeparator;
+                        ++cursor;
+                    }
+                }
+            } else {
+                error = SkipValue(0);
+                if (error != CommandParseError::None) return error;
             }
             
-            return stats;
+            SkipWhitespace();
+            if (cursor == end) return CommandParseError::ExpectedSeparator;
+            if (*cursor == '}') {
+                ++cursor;
+                return CommandParseError::None;
+            }
+            if (*cursor != ',') return CommandParseError::ExpectedSeparator;
+            ++cursor;
+        }
+    }
+    
+    // [{command}, {command}, ...], appended in order
+    CommandParseError ParseCommandArray(std::vector<CommandData>& commands) {
+        ++cursor;
+        SkipWhitespace();
+        if (cursor != end && *cursor == ']') {
+            ++cursor;
+            return CommandParseError::None;
+        }
+        for (;;) {
+            CommandData command;
+            const CommandParseError error = ParseCommand(command);
+            if (error != CommandParseError::None) return error;
+            commands.push_back(command);
+            
+            SkipWhitespace();
+            if (cursor == end) return CommandParseError::ExpectedSeparator;
+            if (*cursor == ']') {
+                ++cursor;
+                return CommandParseError::None;
+            }
+            if (*cursor != ',') return CommandParseError::ExpectedSeparator;
+            ++cursor;
+        }
+    }
+    
+private:
+    static bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+    static bool IsHexDigit(char c) { return IsDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'); }
+    
+    // Cursor on the opening quote; `text` excludes the quotes and is left escaped
+    CommandParseError ParseString(std::string_view& text, bool& escaped) {
+        const char* start = ++cursor;
+        escaped = false;
+        while (cursor != end) {
+            const unsigned char c = (unsigned char)*cursor;
+            if (c == '"') {
+                text = std::string_view(start, (size_t)(cursor - start));
+                ++cursor;
+                return CommandParseError::None;
+            }
+            if (c < 0x20) return CommandParseError::InvalidString;
+            if (c == '\\') {
+                escaped = true;
+                if (++cursor == end) break;
+                switch (*cursor) {
+                    case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+                        break;
+                    case 'u':
+                        for (int i = 0; i < 4; ++i) {
+                            if (++cursor == end || !IsHexDigit(*cursor)) return CommandParseError::InvalidString;
+                        }
+                        break;
+                    default:
+                        return CommandParseError::InvalidString;
+                }
+            }
+            ++cursor;
+        }
+        return CommandParseError::InvalidString;
+    }
+    
+    // JSON number grammar, converted with from_chars (locale independent, no exceptions)
+    CommandParseError ParseNumber(double& value) {
+        const char* start = cursor;
+        const char* p = cursor;
+        if (p != end && *p == '-') ++p;
+        if (p == end || !IsDigit(*p)) return CommandParseError::InvalidNumber;
+        if (*p == '0') {
+            ++p;
+        } else {
+            while (p != end && IsDigit(*p)) ++p;
+        }
+        if (p != end && *p == '.') {
+            if (++p == end || !IsDigit(*p)) return CommandParseError::InvalidNumber;
+            while (p != end && IsDigit(*p)) ++p;
+        }
+        if (p != end && (*p == 'e' || *p == 'E')) {
+            ++p;
+            if (p != end && (*p == '+' || *p == '-')) ++p;
+            if (p == end || !IsDigit(*p)) return CommandParseError::InvalidNumber;
+            while (p != end && IsDigit(*p)) ++p;
+        }
+        
+        const std::from_chars_result result = std::from_chars(start, p, value);
+        if (result.ec != std::errc() || result.ptr != p || !std::isfinite(value)) return CommandParseError::InvalidNumber;
+        cursor = p;
+        return CommandParseError::None;
+    }
+    
+    // "value": a number, or true/false as 1/0
+    CommandParseError ParseNumericValue(double& value) {
+        if (MatchLiteral("true")) {
+            value = 1.0;
+            return CommandParseError::None;
+        }
+        if (MatchLiteral("false")) {
+            value = 0.0;
+            return CommandParseError::None;
+        }
+        if (cursor != end && (*cursor == '-' || IsDigit(*cursor))) return ParseNumber(value);
+        return CommandParseError::InvalidValue;
+    }
+    
+    bool MatchLiteral(std::string_view literal) {
+        if ((size_t)(end - cursor) < literal.size() || std::string_view(cursor, literal.size()) != literal) return false;
+        cursor += literal.size();
+        return true;
+    }
+    
+    // Validates and skips any JSON value (unknown keys)
+    CommandParseError SkipValue(int depth) {
+        if (cursor == end) return CommandParseError::InvalidValue;
+        std::string_view text;
+        bool escaped = false;
+        double number = 0.0;
+        switch (*cursor) {
+            case '"':
+                return ParseString(text, escaped);
+            case '{':
+            case '[': {
+                if (depth >= MAX_DEPTH) return CommandParseError::TooDeep;
+                const char close = *cursor == '{' ? '}' : ']';
+                const bool object = close == '}';
+                ++cursor;
+                SkipWhitespace();
+                if (cursor != end && *cursor == close) {
+                    ++cursor;
+                    return CommandParseError::None;
+                }
+                for (;;) {
+                    SkipWhitespace();
+                    CommandParseError error;
+                    if (object) {
+                        if (cursor == end || *cursor != '"') return CommandParseError::ExpectedKey;
+                        error = ParseString(text, escaped);
+                        if (error != CommandParseError::None) return error;
+                        SkipWhitespace();
+                        if (cursor == end || *cursor != ':') return CommandParseError::ExpectedColon;
+                        ++cursor;
+                        SkipWhitespace();
+                    }
+                    error = SkipValue(depth + 1);
+                    if (error != CommandParseError::None) return error;
+                    SkipWhitespace();
+                    if (cursor == end) return CommandParseError::ExpectedSeparator;
+                    if (*cursor == close) {
+                        ++cursor;
+                        return CommandParseError::None;
+                    }
+                    if (*cursor != ',') return CommandParseError::ExpectedSeparator;
+                    ++cursor;
+                }
+            }
+            default:
+                if (MatchLiteral("true") || MatchLiteral("false") || MatchLiteral("null")) return CommandParseError::None;
+                if (*cursor == '-' || IsDigit(*cursor)) return ParseNumber(number);
+                return CommandParseError::InvalidValue;
+        }
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// COMMAND PROCESSOR - Bidirectional Commands
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Consecutive messages produced by one received command message (a single command or a batch)
+struct CommandRun {
+    uint32_t count;
+    bool same_frame;                    // Send all of them in one Update() or wait for room
+};
+
+// Bounded multi-producer queue of encoded command messages from the network side to the sim
+// thread (same cell protocol as AeroflyCommandRing). A run occupies consecutive cells claimed with
+// one compare-exchange; its first cell is published last and carries the run header, so the
+// consumer only ever sees complete runs and Drain() is a copy per message.
+class CommandQueue {
+public:
+    static constexpr uint32_t CAPACITY = 4096;      // Messages, power of two
+    
+private:
+    struct alignas(64) Cell {
+        std::atomic<uint32_t> sequence;
+        uint32_t run_count;                 // First cell of a run: messages in it; 0 otherwise
+        bool same_frame;
+        tm_external_message message;
+    };
+    
+    std::unique_ptr<Cell[]> cells;
+    alignas(64) std::atomic<uint32_t> enqueue_position;
+    alignas(64) uint32_t dequeue_position;  // Consumer only
+    
+public:
+    CommandQueue() : cells(new Cell[CAPACITY]), enqueue_position(0), dequeue_position(0) {
+        for (uint32_t i = 0; i < CAPACITY; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    
+    // Producer side: all `count` messages or none (queue full, or count > CAPACITY)
+    bool TryPush(const tm_external_message* messages, uint32_t count, bool same_frame) {
+        if (count == 0 || count > CAPACITY) return false;
+        uint32_t position = enqueue_position.load(std::memory_order_relaxed);
+        for (;;) {
+            // Cells are freed in order, so the run fits if its last cell is free
+            const uint32_t last = position + count - 1;
+            const int32_t lag = (int32_t)(cells[last & (CAPACITY - 1)].sequence.load(std::memory_order_acquire) - last);
+            if (lag == 0) {
+                if (enqueue_position.compare_exchange_weak(position, position + count, std::memory_order_relaxed)) break;
+            } else if (lag < 0) {
+                return false;
+            } else {
+                position = enqueue_position.load(std::memory_order_relaxed);
+            }
+        }
+        
+        for (uint32_t i = count; i-- > 0;) {
+            Cell& cell = cells[(position + i) & (CAPACITY - 1)];
+            cell.message = messages[i];
+            cell.run_count = i == 0 ? count : 0;
+            cell.same_frame = same_frame;
+            cell.sequence.store(position + i + 1, std::memory_order_release);
+        }
+        return true;
+    }
+    
+    // Consumer side: appends every complete run to messages/runs; returns the messages taken
+    uint32_t Drain(std::vector<tm_external_message>& messages, std::vector<CommandRun>& runs) {
+        uint32_t taken = 0;
+        while (taken < CAPACITY) {
+            const Cell& head = cells[dequeue_position & (CAPACITY - 1)];
+            if (head.sequence.load(std::memory_order_acquire) != dequeue_position + 1) break;
+            
+            const uint32_t count = head.run_count;
+            runs.push_back(CommandRun{ count, head.same_frame });
+            for (uint32_t i = 0; i < count; i++) {
+                Cell& cell = cells[(dequeue_position + i) & (CAPACITY - 1)];
+                messages.push_back(cell.message);
+                cell.sequence.store(dequeue_position + i + CAPACITY, std::memory_order_release);
+            }
+            dequeue_position += count;
+            taken += count;
+        }
+        return taken;
+    }
+};
+
+// Merges the pending commands of a frame so the output is bounded by distinct variables, not by
+// how fast clients send. Per message ID and flag variant: absolute values keep only the newest,
+// offset/step deltas are summed, and toggles, events and moves are all kept. Deltas older than
+// the newest value write of the same ID are dropped, since that write overrides them. The result
+// sits where the newest of the merged messages was; runs shrink accordingly. same_frame runs are
+// left whole and nothing merges across them, so a batch is never split over two frames.
+class CommandCoalescer {
+private:
+    struct Key {
+        tm_uint64 id;
+        tm_uint64 flags;
+        bool operator==(const Key& other) const { return id == other.id && flags == other.flags; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const { return (size_t)(key.id ^ (key.flags * 0x9E3779B97F4A7C15ull)); }
+    };
+    
+    std::unordered_map<Key, size_t, KeyHash> newest;    // Reused: message index of each variable
+    std::unordered_set<tm_uint64> written;              // Reused: IDs with a newer value write
+    std::vector<uint8_t> keep;
+    
+    enum class Merge { Keep, Sum, Replace };
+    
+    static Merge MergeFor(const tm_external_message& message) {
+        const tm_msg_flag_set flags = message.GetFlags();
+        if (flags.IsSet(tm_msg_flag::Toggle) || flags.IsSet(tm_msg_flag::Event) || flags.IsSet(tm_msg_flag::Move)) {
+            return Merge::Keep;
+        }
+        if (flags.IsSet(tm_msg_flag::Offset) || flags.IsSet(tm_msg_flag::Step)) {
+            return message.GetDataType() == tm_msg_data_type::Double ? Merge::Sum : Merge::Keep;
+        }
+        return Merge::Replace;
+    }
+    
+public:
+    // Returns the number of messages merged away
+    size_t Coalesce(std::vector<tm_external_message>& messages, std::vector<CommandRun>& runs) {
+        if (messages.size() < 2) return 0;
+        newest.clear();
+        written.clear();
+        keep.assign(messages.size(), 1);
+        
+        // Newest first, so the survivor of each variable is its last occurrence
+        size_t merged = 0;
+        size_t end = messages.size();
+        for (size_t r = runs.size(); r-- > 0;) {
+            const size_t begin = end - runs[r].count;
+            if (runs[r].same_frame) {
+                newest.clear();
+                written.clear();
+                end = begin;
+                continue;
+            }
+            for (size_t i = end; i-- > begin;) {
+                const Merge merge = MergeFor(messages[i]);
+                if (merge == Merge::Keep) continue;
+                
+                const tm_uint64 id = messages[i].GetID();
+                if (merge == Merge::Sum && written.count(id)) {
+                    keep[i] = 0;
+                    merged++;
+                    continue;
+                }
+                if (merge == Merge::Replace && !messages[i].GetFlags().IsSet(tm_msg_flag::Active)) {
+                    written.insert(id);
+                }
+                
+                auto inserted = newest.emplace(Key{ id, messages[i].GetFlags().GetFlags() }, i);
+                if (inserted.second) continue;
+                
+                tm_external_message& survivor = messages[inserted.first->second];
+                if (merge == Merge::Sum) {
+                    survivor.SetValue(survivor.GetDouble() + messages[i].GetDouble());
+                }
+                keep[i] = 0;
+                merged++;
+            }
+            end = begin;
+        }
+        if (merged == 0) return 0;
+        
+        size_t out = 0;
+        size_t message = 0;
+        size_t run_out = 0;
+        for (CommandRun run : runs) {
+            uint32_t count = 0;
+            for (uint32_t i = 0; i < run.count; i++, message++) {
+                if (!keep[message]) continue;
+                messages[out++] = messages[message];
+                count++;
+            }
+            if (count > 0) {
+                runs[run_out++] = CommandRun{ count, run.same_frame };
+            }
+        }
+        messages.resize(out);
+        runs.resize(run_out);
+        return merged;
+    }
+};
+
+class EnhancedCommandProcessor {
+    private:
+        VariableMapper mapper;
+        HybridVariableManager* hybrid_manager;
+        std::vector<CommandData> parsed;    // Commands of the message being processed (reused)
+        
+        // Command statistics
+        mutable std::mutex stats_mutex;
+        std::unordered_map<std::string, int> command_stats;
+        std::atomic<uint64_t> ring_commands;    // Applied from the command ring (not in command_stats)
+        
+    public:
+        EnhancedCommandProcessor() : hybrid_manager(nullptr), ring_commands(0) {}
+        
+        void SetHybridManager(HybridVariableManager* manager) {
+            hybrid_manager = manager;
+            HybridLogToFile("EnhancedCommandProcessor: Hybrid manager connected");
+            OutputDebugStringA("Enhanced CommandProcessor: Hybrid manager connected\n");
+        }
+        
+        // Appends the messages of each received command message as one run, in arrival order.
+        // Commands that fail to resolve are skipped; a malformed message contributes nothing.
+        void ProcessCommands(const std::vector<std::string>& commands, std::vector<tm_external_message>& messages,
+                             std::vector<CommandRun>& runs) {
+            for (const auto& command : commands) {
+                bool same_frame = false;
+                const CommandParseError error = CommandParser::ParseMessage(command, parsed, same_frame);
+                if (error != CommandParseError::None) {
+                    HybridLogToFile(std::string("ERROR: Invalid command format (") + CommandParseErrorName(error) + "): " + command);
+                    continue;
+                }
+                
+                CommandRun run{ 0, same_frame };
+                for (const CommandData& cmd_data : parsed) {
+                    auto msg = ProcessEnhancedCommand(cmd_data);
+                    if (msg.GetDataType() != tm_msg_data_type::None) {
+                        messages.push_back(msg);
+                        run.count++;
+                        
+                        // Update statistics
+                        UpdateCommandStats(cmd_data);
+                    }
+                }
+                if (run.count > 0) {
+                    runs.push_back(run);
+                }
+            }
+        }
+        
+        // Appends the message of one command from the shared-memory ring as its own run
+        AeroflyCommandStatus ProcessRingCommand(const AeroflyCommand& command, std::vector<tm_external_message>& messages,
+                                                std::vector<CommandRun>& runs) {
+            static constexpr std::string_view kQualifiers[] = { "", "move", "offset", "step", "toggle", "active", "" };
+            if (command.qualifier > (uint32_t)AeroflyCommandQualifier::Event) return AeroflyCommandStatus::Rejected;
+            
+            CommandData cmd_data;
+            cmd_data.has_handle = true;
+            cmd_data.handle = command.handle != kInvalidHandle ? command.handle
+                                                               : ResolveVariableHandle(command.name_hash, hybrid_manager);
+            cmd_data.qualifier = kQualifiers[command.qualifier];
+            cmd_data.is_event_command = command.qualifier != (uint32_t)AeroflyCommandQualifier::Value;
+            cmd_data.value = command.value;
+            if (cmd_data.handle == kInvalidHandle || !std::isfinite(cmd_data.value)) return AeroflyCommandStatus::Rejected;
+            
+            // Sim thread: no logging or per-command strings; the completion reports the outcome
+            auto msg = EncodeHandleCommand(cmd_data);
+            if (msg.GetDataType() == tm_msg_data_type::None) return AeroflyCommandStatus::Rejected;
+            messages.push_back(msg);
+            runs.push_back(CommandRun{ 1, false });
+            ring_commands.fetch_add(1, std::memory_order_relaxed);
+            return AeroflyCommandStatus::Applied;
+        }
+        
+        // Get command processing statistics
+        std::vector<std::string> GetCommandStats() const {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            std::vector<std::string> stats;
+            
+            for (const auto& pair : command_stats) {
+                stats.push_back(pair.first + ": " + std::to_string(pair.second) + " times");
+            }
+            stats.push_back("AeroflyBridgeCommands: " + std::to_string(ring_commands.load(std::memory_order_relaxed)) + " times");
+            
+            return stats;
+        }
+        
+    private:
+        tm_external_message ProcessEnhancedCommand(const CommandData& cmd_data) {
+            tm_external_message empty_msg;
+            
+            try {
+                if (cmd_data.has_handle) {
+                    return ProcessHandleCommand(cmd_data);
+                }
+                
+                HybridLogToFile("Parsed command - Variable: " + std::string(cmd_data.variable_name) + 
+                               ", Event: " + std::string(cmd_data.event_type) + 
+                               ", Qualifier: " + std::string(cmd_data.qualifier) + 
+                               ", Value: " + std::to_string(cmd_data.value));
+                
+                // Try core variables first (maximum performance)
+                tm_external_message core_msg = TryProcessCoreVariable(cmd_data);
+                if (core_msg.GetDataType() != tm_msg_data_type::None) {
+                    HybridLogToFile("✅ CORE: Variable processed: " + std::string(cmd_data.variable_name));
+                    return core_msg;
+                }
+                
+                // Try hybrid system for dynamic variables
+                if (hybrid_manager) {
+                    tm_external_message hybrid_msg = TryProcessHybridVariable(cmd_data);
+                    if (hybrid_msg.GetDataType() != tm_msg_data_type::None) {
+                        HybridLogToFile("✅ HYBRID: Variable processed: " + std::string(cmd_data.variable_name));
+                        return hybrid_msg;
+                    }
+                }
+                
+                HybridLogToFile("❌ Variable not found in core or hybrid: " + std::string(cmd_data.variable_name));
+                return empty_msg;
+                
+            } catch (const std::exception& e) {
+                HybridLogToFile("ERROR processing enhanced command: " + std::string(e.what()));
+                return empty_msg;
+            } catch (...) {
+                HybridLogToFile("Unknown ERROR parsing enhanced command");
+                return empty_msg;
+            }
+        }
+        
+        tm_external_message TryProcessCoreVariable(const CommandData& cmd_data) {
+            // O(1) in the route table generated from MESSAGE_LIST (every writable Double variable)
+            const CommandRoute* route = kCommandRoutes.Find(MessageNameHash(cmd_data.variable_name));
+            if (!route) {
+                return tm_external_message(); // Not found in core
+            }
+            return ProcessCoreRoute(*route, cmd_data);
+        }
+        
+        tm_external_message ProcessCoreRoute(const CommandRoute& route, const CommandData& cmd_data) {
+            const MessageDescriptor& d = SelectVariant(route, cmd_data);
+            tm_external_message message(tm_string_hash(d.hash), d.data_type, d.flag, d.access, d.unit);
+            return ProcessCoreMessage(message, cmd_data);
+        }
+        
+        // Handle commands index the tables directly instead of looking names up
+        tm_external_message ProcessHandleCommand(const CommandData& cmd_data) {
+            tm_external_message message = EncodeHandleCommand(cmd_data);
+            if (message.GetDataType() == tm_msg_data_type::None) {
+                HybridLogToFile("❌ Unknown or read-only handle: " + std::to_string(cmd_data.handle));
+            }
+            return message;
+        }
+        
+        // Same messages as the named path, but without logging: handles are the high-rate path and
+        // the command ring encodes on the sim thread. Values are set as ProcessCoreMessage and
+        // ProcessHybridEvent do (toggles send 1). Empty message for unknown or read-only handles.
+        tm_external_message EncodeHandleCommand(const CommandData& cmd_data) {
+            const uint32_t handle = cmd_data.handle;
+            
+            if (handle < (uint32_t)MessageDescriptorTable::kCount) {
+                const CommandRoute* route = kCommandRoutes.Find(kMessageTable[(int)handle].hash);
+                if (route) {
+                    const MessageDescriptor& d = SelectVariant(*route, cmd_data);
+                    tm_external_message message(tm_string_hash(d.hash), d.data_type, d.flag, d.access, d.unit);
+                    const bool toggle = cmd_data.is_event_command &&
+                                        (cmd_data.event_type == "OnToggle" || cmd_data.qualifier == "toggle");
+                    message.SetValue(toggle ? 1.0 : cmd_data.value);
+                    return message;
+                }
+            } else if ((handle & kDynamicHandleFlag) && hybrid_manager) {
+                const uint32_t slot = handle & ~kDynamicHandleFlag;
+                bool is_toggle = false;
+                const tm_external_message* cached = hybrid_manager->GetDynamicMessage(slot, is_toggle);
+                if (cached) {
+                    tm_external_message message = *cached;
+                    const bool toggle = cmd_data.is_event_command && cmd_data.qualifier == "toggle" && is_toggle;
+                    message.SetValue(toggle ? 1.0 : cmd_data.value);
+                    return message;
+                }
+            }
+            return tm_external_message();
+        }
+        
+        // The flag variant of a routed name that the qualifier/event asks for (Controls.Trim "step",
+        // Controls.Gear "toggle"...). Other events use the name's Event variant if it has one;
+        // everything else uses the first (Value) entry.
+        static const MessageDescriptor& SelectVariant(const CommandRoute& route, const CommandData& cmd_data) {
+            const std::string_view qualifier = cmd_data.qualifier;
+            tm_msg_flag wanted = tm_msg_flag::None;
+            if (qualifier == "move") wanted = tm_msg_flag::Move;
+            else if (qualifier == "offset") wanted = tm_msg_flag::Offset;
+            else if (qualifier == "active") wanted = tm_msg_flag::Active;
+            else if (qualifier == "step" || cmd_data.event_type == "OnStep") wanted = tm_msg_flag::Step;
+            else if (qualifier == "toggle" || cmd_data.event_type == "OnToggle") wanted = tm_msg_flag::Toggle;
+            
+            const MessageDescriptor* event_variant = nullptr;
+            for (int16_t entry : route.entries) {
+                if (entry < 0) break;
+                const MessageDescriptor& d = kMessageTable[entry];
+                if (wanted != tm_msg_flag::None && d.flag == wanted) return d;
+                if (d.flag == tm_msg_flag::Event && !event_variant) event_variant = &d;
+            }
+            return cmd_data.is_event_command && event_variant ? *event_variant : kMessageTable[route.entries[0]];
+        }
+        
+        tm_external_message ProcessCoreMessage(tm_external_message& core_message, 
+                                              const CommandData& cmd_data) {
+            try {
+                if (cmd_data.is_event_command) {
+                    // Handle event-based commands
+                    if (cmd_data.event_type == "OnStep" || cmd_data.qualifier == "step") {
+                        core_message.SetValue(cmd_data.value);
+                        HybridLogToFile("Core step event: " + std::string(cmd_data.variable_name) + 
+                                       " = " + std::to_string(cmd_data.value));
+                    }
+                    else if (cmd_data.event_type == "OnToggle" || cmd_data.qualifier == "toggle") {
+                        core_message.SetValue(1.0); // Trigger value
+                        HybridLogToFile("Core toggle event: " + std::string(cmd_data.variable_name));
+                    }
+                    else if (cmd_data.qualifier == "offset") {
+                        core_message.SetValue(cmd_data.value);
+                        HybridLogToFile("Core offset event: " + std::string(cmd_data.variable_name) + 
+                                       " offset=" + std::to_string(cmd_data.value));
+                    }
+                    else {
+                        core_message.SetValue(cmd_data.value);
+                        HybridLogToFile("Core default event: " + std::string(cmd_data.variable_name) + 
+                                       " = " + std::to_string(cmd_data.value));
+                    }
+                } else {
+                    // Standard value command
+                    core_message.SetValue(cmd_data.value);
+                    HybridLogToFile("Core value: " + std::string(cmd_data.variable_name) + 
+                                   " = " + std::to_string(cmd_data.value));
+                }
+                
+                return core_message;
+                
+            } catch (const std::exception& e) {
+                HybridLogToFile("ERROR processing core message: " + std::string(e.what()));
+                tm_external_message empty_msg;
+                return empty_msg;
+            }
+        }
+        
+        tm_external_message TryProcessHybridVariable(const CommandData& cmd_data) {
+            tm_external_message empty_msg;
+            
+            try {
+                const std::string variable_name(cmd_data.variable_name);
+                tm_external_message* hybrid_msg = hybrid_manager->GetMessage(variable_name);
+                if (!hybrid_msg) {
+                    HybridLogToFile("Hybrid variable not found: " + variable_name);
+                    return empty_msg;
+                }
+                
+                // Get variable info for enhanced processing (events only)
+                const EnhancedVariableInfo* var_info =
+                    cmd_data.is_event_command ? hybrid_manager->FindVariableInfo(variable_name) : nullptr;
+                
+                // Work on a copy rather than the message the manager hands to every caller
+                tm_external_message message = *hybrid_msg;
+                if (cmd_data.is_event_command && var_info) {
+                    // Process enhanced event command
+                    return ProcessHybridEvent(message, cmd_data, *var_info);
+                } else {
+                    // Process simple value command
+                    message.SetValue(cmd_data.value);
+                    HybridLogToFile("Hybrid value: " + std::string(cmd_data.variable_name) + 
+                                   " = " + std::to_string(cmd_data.value));
+                    return message;
+                }
+                
+            } catch (const std::exception& e) {
+                HybridLogToFile("ERROR processing hybrid variable: " + std::string(e.what()));
+                return empty_msg;
+            }
+        }
+        
+        tm_external_message ProcessHybridEvent(tm_external_message& hybrid_msg,
+                                              const CommandData& cmd_data,
+                                              const EnhancedVariableInfo& var_info) {
+            
+            HybridLogToFile("Processing hybrid event: " + std::string(cmd_data.variable_name) + 
+                           " event=" + std::string(cmd_data.event_type) + " qualifier=" + std::string(cmd_data.qualifier));
+            
+            // Validate qualifier
+            if (!cmd_data.qualifier.empty() && !var_info.HasQualifier(std::string(cmd_data.qualifier))) {
+                HybridLogToFile("WARNING: Invalid qualifier '" + std::string(cmd_data.qualifier) + 
+                               "' for variable " + std::string(cmd_data.variable_name));
+                // Continue anyway, might still work
+            }
+            
+            try {
+                if (cmd_data.qualifier == "step" && var_info.is_step) {
+                    hybrid_msg.SetValue(cmd_data.value);
+                    HybridLogToFile("Hybrid step: " + std::string(cmd_data.variable_name) + 
+                                   " step=" + std::to_string(cmd_data.value));
+                }
+                else if (cmd_data.qualifier == "toggle" && var_info.is_toggle) {
+                    hybrid_msg.SetValue(1.0); // Trigger toggle
+                    HybridLogToFile("Hybrid toggle: " + std::string(cmd_data.variable_name));
+                }
+                else if (cmd_data.qualifier == "move" && var_info.is_move) {
+                    hybrid_msg.SetValue(cmd_data.value);
+                    HybridLogToFile("Hybrid move: " + std::string(cmd_data.variable_name) + 
+                                   " rate=" + std::to_string(cmd_data.value));
+                }
+                else if (cmd_data.qualifier == "offset" && var_info.is_offset) {
+                    hybrid_msg.SetValue(cmd_data.value);
+                    HybridLogToFile("Hybrid offset: " + std::string(cmd_data.variable_name) + 
+                                   " offset=" + std::to_string(cmd_data.value));
+                }
+                else if (cmd_data.qualifier == "active" && var_info.is_active) {
+                    hybrid_msg.SetValue(cmd_data.value);
+                    HybridLogToFile("Hybrid active: " + std::string(cmd_data.variable_name) + 
+                                   " active=" + std::to_string(cmd_data.value));
+                }
+                else {
+                    // Default: standard value setting
+                    hybrid_msg.SetValue(cmd_data.value);
+                    HybridLogToFile("Hybrid default: " + std::string(cmd_data.variable_name) + 
+                                   " = " + std::to_string(cmd_data.value));
+                }
+                
+                return hybrid_msg;
+                
+            } catch (const std::exception& e) {
+                HybridLogToFile("ERROR in hybrid event processing: " + std::string(e.what()));
+                tm_external_message empty_msg;
+                return empty_msg;
+            }
+        }
+        
+        void UpdateCommandStats(const CommandData& cmd_data) {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            command_stats[cmd_data.has_handle ? "#" + std::to_string(cmd_data.handle) : std::string(cmd_data.variable_name)]++;
+        }
+    };
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// TCP SERVER INTERFACE - Network Interface
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+class TCPServerInterface {
+private:
+    // Command connection: stays open for any number of pipelined commands, read by the reactor.
+    // A command is one line ("{...}\n"), or "<length>:" followed by exactly that many bytes when
+    // it contains newlines. An unterminated last line still counts once the client closes, so
+    // one-shot clients that send a bare JSON object and disconnect keep working.
+    struct CommandClient {
+        static constexpr size_t MAX_COMMAND = 64 * 1024;
+        static constexpr size_t MAX_OUTGOING = 1024 * 1024;     // Unread replies before the client is dropped
+        
+        SOCKET socket;
+        std::string pending;            // Received bytes not yet split into commands
+        std::string outgoing;           // Replies (resolve requests) not yet sent
+        
+        explicit CommandClient(SOCKET s) : socket(s) {}
+        
+        // Sends as much of `outgoing` as the socket takes; false on a send error or a client that
+        // stopped reading
+        bool Flush() {
+            while (!outgoing.empty()) {
+                const int sent = send(socket, outgoing.data(), (int)outgoing.size(), 0);
+                if (sent == SOCKET_ERROR) {
+                    return WSAGetLastError() == WSAEWOULDBLOCK && outgoing.size() <= MAX_OUTGOING;
+                }
+                outgoing.erase(0, (size_t)sent);
+            }
+            return true;
+        }
+        
+        // Moves every complete command into `commands`; false on a framing error (oversized
+        // command or malformed length), after which the connection should be closed
+        bool Extract(std::vector<std::string>& commands, bool end_of_stream) {
+            size_t pos = 0;
+            bool valid = true;
+            while (pos < pending.size()) {
+                const char c = pending[pos];
+                if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+                    ++pos;
+                    continue;
+                }
+                
+                if (c >= '0' && c <= '9') {
+                    // Length-prefixed: "<digits>:<payload>"
+                    size_t length = 0;
+                    size_t digit = pos;
+                    while (digit < pending.size() && pending[digit] >= '0' && pending[digit] <= '9' &&
+                           length <= MAX_COMMAND) {
+                        length = length * 10 + (size_t)(pending[digit++] - '0');
+                    }
+                    if (length > MAX_COMMAND || (digit < pending.size() && pending[digit] != ':')) {
+                        valid = false;
+                        break;
+                    }
+                    if (digit == pending.size() || pending.size() - (digit + 1) < length) break;   // Incomplete
+                    commands.emplace_back(pending, digit + 1, length);
+                    pos = digit + 1 + length;
+                    continue;
+                }
+                
+                // Newline-delimited
+                size_t end = pending.find('\n', pos);
+                if (end == std::string::npos) {
+                    if (!end_of_stream) break;
+                    end = pending.size();
+                }
+                size_t last = end;
+                while (last > pos && (pending[last - 1] == '\r' || pending[last - 1] == ' ')) --last;
+                commands.emplace_back(pending, pos, last - pos);
+                pos = end;
+            }
+            pending.erase(0, pos);
+            return valid && pending.size() <= MAX_COMMAND + 16;
+        }
+    };
+    
+    SOCKET server_socket;               // Data stream listener
+    SOCKET command_socket;              // Command listener
+    std::thread reactor_thread;
+    std::thread encoder_thread;
+    std::atomic<bool> running;
+    VariableMapper mapper;
+    
+    // Sim thread -> encoder thread -> reactor thread
+    FrameMailbox frame_mailbox;
+    ReactorWakeup wakeup;
+    SocketPoller poller;
+    std::mutex clients_mutex;           // Guards the client queues shared with the encoder
+    std::vector<std::unique_ptr<BroadcastClient>> data_clients;     // Added/removed by the reactor only
+    std::vector<CommandClient> command_clients;                     // Reactor thread only
+    std::atomic<int> client_count;
+    std::atomic<uint64_t> frames_published;
+    std::atomic<uint64_t> frames_dropped;
+    std::atomic<uint64_t> clients_evicted;
+    std::atomic<uint64_t> clients_disconnected;
+    
+    // Command processing: parsed and encoded by the reactor, drained by the sim thread
+    EnhancedCommandProcessor* command_processor;
+    CommandQueue command_queue;
+    std::atomic<bool> commands_stalled;             // Reactor stopped reading, the queue was full
+    std::vector<tm_external_message> parsed_messages;   // Reactor thread only: waiting for queue room
+    std::vector<CommandRun> parsed_runs;
+    std::vector<std::string_view> resolve_names;    // Reactor thread only (reused)
+    
+    // Encoder thread only
+    JsonFrameEncoder json_encoder;
+    BinaryFrameEncoder binary_encoder;
+    std::vector<std::shared_ptr<StreamSubscription>> subscriptions;    // Interned, see InternSubscription()
+    
+    // Dynamic variables streamed by subscriptions: resolved through hybrid_manager, assigned by
+    // the encoder thread, snapshotted by the sim thread in BroadcastData(). Positions no live
+    // subscription uses are reassigned; frames carry their slots, so stale values are not sent.
+    const HybridVariableManager* hybrid_manager;
+    std::atomic<uint32_t> stream_dynamic_slots[StreamFrame::MAX_DYNAMIC];
+    std::atomic<uint32_t> stream_dynamic_count;
+    bool stream_dynamic_used[StreamFrame::MAX_DYNAMIC];     // Encoder thread only
+    
+public:
+    TCPServerInterface() : server_socket(INVALID_SOCKET), command_socket(INVALID_SOCKET), running(false), client_count(0),
+                           frames_published(0), frames_dropped(0), clients_evicted(0), clients_disconnected(0),
+                           command_processor(nullptr), commands_stalled(false), hybrid_manager(nullptr),
+                           stream_dynamic_slots(), stream_dynamic_count(0), stream_dynamic_used() {}
+    
+    ~TCPServerInterface() {
+        Stop();
+    }
+    
+    bool Start(int data_port = 12345, int command_port = 12346) {
+        // Initialize Winsock
+        WSADATA wsaData;
+        if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+            return false;
+        }
+        
+        // Data listener is required
+        server_socket = CreateListener(data_port);
+        if (server_socket == INVALID_SOCKET || !wakeup.Open()) {
+            if (server_socket != INVALID_SOCKET) {
+                closesocket(server_socket);
+                server_socket = INVALID_SOCKET;
+            }
+            WSACleanup();
+            return false;
+        }
+        
+        // Command listener is optional, the data stream works without it
+        command_socket = CreateListener(command_port);
+        if (command_socket == INVALID_SOCKET) {
+            OutputDebugStringA("Failed to bind/listen command socket\n");
+        }
+        
+        // Start network threads
+        running = true;
+        frame_mailbox.Open();
+        encoder_thread = std::thread(&TCPServerInterface::EncoderLoop, this);
+        reactor_thread = std::thread(&TCPServerInterface::ReactorLoop, this);
+        
+        return true;
+    }
+    
+    void Stop() {
+        OutputDebugStringA("=== TCPServer::Stop() STARTED ===\n");
+        
+        // Mark as not running FIRST, then wake both threads (no select timeouts to wait out)
+        running = false;
+        frame_mailbox.Close();
+        wakeup.Signal();
+        
+        if (encoder_thread.joinable()) {
+            encoder_thread.join();
+        }
+        if (reactor_thread.joinable()) {
+            OutputDebugStringA("Waiting for reactor_thread...\n");
+            reactor_thread.join();
+            OutputDebugStringA("reactor_thread finished\n");
+        }
+        
+        // Close all client connections
+        OutputDebugStringA("Closing client connections...\n");
+        {
+            std::lock_guard<std::mutex> lock(clients_mutex);
+            for (auto& client : data_clients) {
+                shutdown(client->socket, SD_BOTH);
+                closesocket(client->socket);
+            }
+            data_clients.clear();
+        }
+        for (const CommandClient& client : command_clients) {
+            closesocket(client.socket);
+        }
+        command_clients.clear();
+        client_count = 0;
+        
+        // Close listeners
+        if (server_socket != INVALID_SOCKET) {
+            OutputDebugStringA("Closing main server socket...\n");
+            closesocket(server_socket);
+            server_socket = INVALID_SOCKET;
+        }
+        if (command_socket != INVALID_SOCKET) {
+            closesocket(command_socket);
+            command_socket = INVALID_SOCKET;
+        }
+        wakeup.Close();
+        
+        OutputDebugStringA("=== TCPServer::Stop() COMPLETED ===\n");
+    }
+    
+    // Sim thread: hands a copy of the frame to the encoder thread and returns. Encoding and
+    // sending happen on the network threads, so slow or many clients never stall the simulator.
+    void BroadcastData(const AeroflyBridgeData* data) {
+        if (!data || !running) return;
+        
+        frames_published++;
+        const uint32_t dynamic_count = stream_dynamic_count.load(std::memory_order_acquire);
+        frame_mailbox.Push(*data, data->dynamic_values, stream_dynamic_slots, dynamic_count);
+    }
+    
+    // Call before Start(); lets subscriptions name discovered dynamic variables
+    void SetHybridManager(const HybridVariableManager* manager) {
+        hybrid_manager = manager;
+    }
+    
+    BroadcastStats GetBroadcastStats() const {
+        BroadcastStats stats;
+        stats.frames_published = frames_published;
+        stats.frames_skipped = frame_mailbox.frames_dropped;
+        stats.frames_dropped = frames_dropped;
+        stats.clients_evicted = clients_evicted;
+        stats.clients_disconnected = clients_disconnected;
+        return stats;
+    }
+    
+private:
+    // Non-blocking listening socket on all interfaces; INVALID_SOCKET on failure
+    static SOCKET CreateListener(int port) {
+        SOCKET listener = socket(AF_INET, SOCK_STREAM, 0);
+        if (listener == INVALID_SOCKET) {
+            return INVALID_SOCKET;
+        }
+        
+        // Allow socket reuse
+        int opt = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (char*)&opt, sizeof(opt));
+        
+        sockaddr_in addr;
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = INADDR_ANY;
+        addr.sin_port = htons(port);
+        
+        u_long mode = 1;
+        if (bind(listener, (sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR ||
+            listen(listener, SOMAXCONN) == SOCKET_ERROR ||
+            ioctlsocket(listener, FIONBIO, &mode) == SOCKET_ERROR) {
+            closesocket(listener);
+            return INVALID_SOCKET;
+        }
+        return listener;
+    }
+    
+    // Registers a dynamic_values slot for BroadcastData() to snapshot; returns its position in
+    // StreamFrame::dynamic_values, or -1 when all MAX_DYNAMIC positions are in use
+    int RegisterStreamDynamic(uint32_t slot) {
+        const uint32_t count = stream_dynamic_count.load(std::memory_order_relaxed);
+        uint32_t position = count;
+        for (uint32_t i = 0; i < count; i++) {
+            if (!stream_dynamic_used[i]) {
+                position = (std::min)(position, i);
+            } else if (stream_dynamic_slots[i].load(std::memory_order_relaxed) == slot) {
+                return (int)i;
+            }
+        }
+        if (position == StreamFrame::MAX_DYNAMIC) return -1;
+        stream_dynamic_slots[position].store(slot, std::memory_order_relaxed);
+        stream_dynamic_used[position] = true;
+        if (position == count) {
+            stream_dynamic_count.store(count + 1, std::memory_order_release);
+        }
+        return (int)position;
+    }
+    
+    // Frees the positions no remaining subscription streams, for RegisterStreamDynamic() to reuse
+    void ReleaseStreamDynamic() {
+        std::fill(std::begin(stream_dynamic_used), std::end(stream_dynamic_used), false);
+        for (const auto& subscription : subscriptions) {
+            for (uint16_t position : subscription->dynamic) {
+                stream_dynamic_used[position] = true;
+            }
+        }
+    }
+    
+    // Adds a dynamic_values slot to a subscription under its name; false if the stream is full
+    bool AddStreamDynamic(StreamSubscription& subscription, uint32_t slot, const char* name) {
+        const int position = RegisterStreamDynamic(slot);
+        if (position < 0) return false;
+        if (std::find(subscription.dynamic.begin(), subscription.dynamic.end(), (uint16_t)position) ==
+            subscription.dynamic.end()) {
+            subscription.dynamic.push_back((uint16_t)position);
+            subscription.dynamic_slots.push_back(slot);
+            subscription.dynamic_keys.push_back(std::string("\"") + name + "\":");
         }
+        return true;
+    }
+    
+    static int FirstVariableNamed(const char* name) {
+        for (int i = 0; i < (int)VariableIndex::VARIABLE_COUNT; ++i) {
+            if (strcmp(kMessageNames[i], name) == 0) return i;
+        }
+        return -1;
+    }
+    
+    // Handshake tokens: VARS=<item>,<item>,..., RATE=<Hz> and AGG=<last|avg|min|max|peak>. An item
+    // is an SDK name ("Aircraft.Altitude"), a category ("Autopilot.*"), a handle or range of core
+    // handles ("12", "40-60"), or the name or handle of a discovered dynamic variable. Unknown items
+    // are skipped.
+    std::unique_ptr<StreamSubscription> ParseSubscription(const std::string& handshake) {
+        std::unique_ptr<StreamSubscription> subscription = std::make_unique<StreamSubscription>();
+        const int variable_count = (int)VariableIndex::VARIABLE_COUNT;
+        std::istringstream tokens(handshake);
+        std::string token;
         
-    private:
-        tm_external_message ParseEnhancedCommand(const std::string& command) {
-            tm_external_message empty_msg;
+        while (tokens >> token) {
+            if (token.compare(0, 5, "RATE=") == 0) {
+                const double rate = strtod(token.c_str() + 5, nullptr);
+                subscription->interval_us =
+                    rate > 0.0 ? (uint64_t)(1000000.0 / std::max(rate, StreamSubscription::MIN_RATE_HZ)) : 0;
+                continue;
+            }
+            if (token.compare(0, 4, "AGG=") == 0) {
+                const std::string mode = token.substr(4);
+                subscription->aggregation = mode == "avg" ? StreamAggregation::Mean :
+                                            mode == "min" ? StreamAggregation::Min :
+                                            mode == "max" ? StreamAggregation::Max :
+                                            mode == "peak" ? StreamAggregation::Peak : StreamAggregation::Last;
+                continue;
+            }
+            if (token.compare(0, 5, "VARS=") != 0) continue;
             
-            try {
-                HybridLogToFile("Processing enhanced command: " + command);
-                
-                // Parse JSON command
-                CommandData cmd_data = ExtractCommandData(command);
-                if (cmd_data.variable_name.empty()) {
-                    HybridLogToFile("ERROR: Invalid command format");
-                    return empty_msg;
-                }
-                
-                HybridLogToFile("Parsed command - Variable: " + cmd_data.variable_name + 
-                               ", Event: " + cmd_data.event_type + 
-                               ", Qualifier: " + cmd_data.qualifier + 
-                               ", Value: " + std::to_string(cmd_data.value));
-                
-                // Try core variables first (maximum performance)
-                tm_external_message core_msg = TryProcessCoreVariable(cmd_data);
-                if (core_msg.GetDataType() != tm_msg_data_type::None) {
-                    HybridLogToFile("✅ CORE: Variable processed: " + cmd_data.variable_name);
-                    return core_msg;
-                }
+            subscription->all_variables = false;
+            std::istringstream items(token.substr(5));
+            std::string item;
+            while (std::getline(items, item, ',')) {
+                if (item.empty()) continue;
                 
-                // Try hybrid system for dynamic variables
-                if (hybrid_manager) {
-                    tm_external_message hybrid_msg = TryProcessHybridVariable(cmd_data);
-                    if (hybrid_msg.GetDataType() != tm_msg_data_type::None) {
-                        HybridLogToFile("✅ HYBRID: Variable processed: " + cmd_data.variable_name);
-                        return hybrid_msg;
+                if (isdigit((unsigned char)item[0])) {
+                    char* end = nullptr;
+                    const unsigned long first = strtoul(item.c_str(), &end, 10);
+                    const unsigned long last = (*end == '-') ? strtoul(end + 1, nullptr, 10) : first;
+                    if (first >= kDynamicHandleFlag && first != kInvalidHandle) {
+                        const uint32_t slot = (uint32_t)first & ~kDynamicHandleFlag;
+                        const char* name = hybrid_manager ? hybrid_manager->DynamicSlotName(slot) : nullptr;
+                        if (!name || !AddStreamDynamic(*subscription, slot, name)) {
+                            OutputDebugStringA(("Subscription: skipped '" + item + "'\n").c_str());
+                        }
+                    }
+                    for (unsigned long i = first; i <= last && i < (unsigned long)variable_count; ++i) {
+                        subscription->variables.push_back((uint16_t)i);
+                    }
+                } else if (item.size() > 2 && item.compare(item.size() - 2, 2, ".*") == 0) {
+                    const std::string prefix = item.substr(0, item.size() - 1);
+                    for (int i = 0; i < variable_count; ++i) {
+                        // Value/Move/Offset variants share a name; keep the first (Value) slot
+                        if (strncmp(kMessageNames[i], prefix.c_str(), prefix.size()) == 0 &&
+                            FirstVariableNamed(kMessageNames[i]) == i) {
+                            subscription->variables.push_back((uint16_t)i);
+                        }
+                    }
+                } else if (FirstVariableNamed(item.c_str()) >= 0) {
+                    subscription->variables.push_back((uint16_t)FirstVariableNamed(item.c_str()));
+                } else {
+                    uint32_t slot;
+                    const bool valid_key = item.find_first_of("\"\\") == std::string::npos;
+                    if (!valid_key || !hybrid_manager || !hybrid_manager->FindDynamicSlot(item, slot) ||
+                        !AddStreamDynamic(*subscription, slot, item.c_str())) {
+                        OutputDebugStringA(("Subscription: skipped '" + item + "'\n").c_str());
                     }
                 }
-                
-                HybridLogToFile("❌ Variable not found in core or hybrid: " + cmd_data.variable_name);
-                return empty_msg;
-                
-            } catch (const std::exception& e) {
-                HybridLogToFile("ERROR parsing enhanced command: " + std::string(e.what()));
-                return empty_msg;
-            } catch (...) {
-                HybridLogToFile("Unknown ERROR parsing enhanced command");
-                return empty_msg;
             }
         }
         
-        struct CommandData {
-            std::string variable_name;
-            std::string event_type;
-            std::string qualifier;
-            double value;
-            bool is_event_command;
-            
-            CommandData() : value(0.0), is_event_command(false) {}
-        };
+        std::sort(subscription->variables.begin(), subscription->variables.end());
+        subscription->variables.erase(std::unique(subscription->variables.begin(), subscription->variables.end()),
+                                      subscription->variables.end());
         
-        CommandData ExtractCommandData(const std::string& command) {
-            CommandData cmd_data;
-            
-            // Find JSON boundaries
-            size_t start = command.find('{');
-            size_t end = command.rfind('}');
-            
-            if (start == std::string::npos || end == std::string::npos) {
-                return cmd_data; // Invalid JSON
-            }
-            
-            std::string json_str = command.substr(start, end - start + 1);
+        // Without RATE= every window is a single frame
+        if (subscription->interval_us == 0) {
+            subscription->aggregation = StreamAggregation::Last;
+        }
+        return subscription;
+    }
+    
+    // Returns the existing subscription equal to this one, so its clients share encodings
+    std::shared_ptr<StreamSubscription> InternSubscription(std::unique_ptr<StreamSubscription> subscription) {
+        for (const auto& existing : subscriptions) {
+            if (existing->SameAs(*subscription)) return existing;
+        }
+        if (subscription->aggregation != StreamAggregation::Last) {
+            subscription->aggregator = std::make_unique<VariableAggregator>(subscription->aggregation);
+            subscription->aggregated = std::make_unique<AeroflyFrameData>();
+        }
+        subscriptions.push_back(std::shared_ptr<StreamSubscription>(std::move(subscription)));
+        return subscriptions.back();
+    }
+    
+    // Encoding a client gets for the current frame; -1 while its handshake is pending
+    static int ChooseEncoding(const BroadcastClient& client) {
+        const StreamSubscription* subscription = client.subscription.get();
+        if (client.mode == BroadcastClient::StreamMode::Pending || !subscription) return -1;
+        const bool send_delta = client.delta && !subscription->keyframe_due && subscription->delta.base_sequence != 0 &&
+                                client.last_sequence == subscription->delta.base_sequence;
+        return (client.mode == BroadcastClient::StreamMode::Binary ? STREAM_BINARY : STREAM_JSON) +
+               (send_delta ? STREAM_DELTA : 0);
+    }
+    
+    // Builds the encodings some client of the subscription needs for this frame. Full-frame
+    // subscriptions use the complete JSON/binary frames; the others send their variables as
+    // changes against base 0 (complete set) or against the previous frame (DELTA clients).
+    void EncodeSubscription(StreamSubscription& subscription, const StreamFrame& stream_frame) {
+        const AeroflyFrameData& frame = subscription.aggregator ? *subscription.aggregated : stream_frame.frame;
+        const FrameDeltaTracker& delta = subscription.delta;
+        double dynamic_values[StreamFrame::MAX_DYNAMIC];
+        const uint32_t dynamic_count = (uint32_t)subscription.dynamic.size();
+        for (uint32_t n = 0; n < dynamic_count; n++) {
+            // 0 until the frames snapshotted before the position was (re)assigned are through
+            const uint16_t position = subscription.dynamic[n];
+            const bool current = position < stream_frame.dynamic_count &&
+                                 stream_frame.dynamic_slots[position] == subscription.dynamic_slots[n];
+            dynamic_values[n] = current ? stream_frame.dynamic_values[position] : 0.0;
+        }
+        
+        for (int encoding = 0; encoding < STREAM_ENCODING_COUNT; ++encoding) {
+            if (!subscription.needed[encoding]) continue;
+            const bool binary = (encoding & STREAM_BINARY) != 0;
+            const bool send_delta = (encoding & STREAM_DELTA) != 0;
             
-            // Extract variable name
-            size_t var_pos = json_str.find("\"variable\"");
-            if (var_pos != std::string::npos) {
-                size_t var_start = json_str.find(":", var_pos) + 1;
-                var_start = json_str.find("\"", var_start) + 1;
-                size_t var_end = json_str.find("\"", var_start);
-                cmd_data.variable_name = json_str.substr(var_start, var_end - var_start);
+            std::string_view bytes;
+            if (subscription.all_variables && !send_delta) {
+                // Aggregated frames share update_counter with the sim frame, so skip the JSON text cache
+                bytes = binary ? binary_encoder.Encode(frame) : json_encoder.Encode(frame, !subscription.aggregator);
+            } else {
+                const uint32_t base = send_delta ? delta.base_sequence : 0;
+                const uint16_t* indices = send_delta ? delta.indices : subscription.variables.data();
+                const uint32_t count = send_delta ? delta.count : (uint32_t)subscription.variables.size();
+                bytes = binary ? binary_encoder.EncodeChanges(frame, base, indices, count, dynamic_values, dynamic_count)
+                               : json_encoder.EncodeChanges(frame, base, indices, count, subscription.dynamic_keys.data(),
+                                                            dynamic_values, dynamic_count);
             }
+            subscription.encoded[encoding] = std::make_shared<const std::string>(bytes);
+        }
+    }
+    
+    // Encodes each frame at most once per subscription and encoding in use, queues the shared
+    // results for every client and wakes the reactor. Delta clients get a keyframe on connect,
+    // after any lost frame and every KEYFRAME_INTERVAL frames of their subscription.
+    void EncoderLoop() {
+        std::unique_ptr<StreamFrame> stream_frame = std::make_unique<StreamFrame>();
+        const AeroflyFrameData& frame = stream_frame->frame;
+        
+        while (frame_mailbox.Pop(*stream_frame)) {
+            if (client_count.load(std::memory_order_relaxed) == 0) continue;
             
-            // Extract value
-            size_t val_pos = json_str.find("\"value\"");
-            if (val_pos != std::string::npos) {
-                size_t val_start = json_str.find(":", val_pos) + 1;
-                while (val_start < json_str.length() && 
-                       (json_str[val_start] == ' ' || json_str[val_start] == '\t')) {
-                    val_start++;
+            // Finish handshakes: every client with a known mode gets an (interned) subscription
+            {
+                std::lock_guard<std::mutex> lock(clients_mutex);
+                const ULONGLONG now = GetTickCount64();
+                for (auto& client : data_clients) {
+                    if (client->ResolveMode(now) && !client->subscription) {
+                        client->subscription = InternSubscription(ParseSubscription(client->handshake));
+                    }
                 }
-                size_t val_end = json_str.find_first_of(",}", val_start);
-                std::string val_str = json_str.substr(val_start, val_end - val_start);
-                cmd_data.value = std::stod(val_str);
             }
             
-            // Extract event type (optional)
-            size_t event_pos = json_str.find("\"event\"");
-            if (event_pos != std::string::npos) {
-                size_t event_start = json_str.find(":", event_pos) + 1;
-                event_start = json_str.find("\"", event_start) + 1;
-                size_t event_end = json_str.find("\"", event_start);
-                cmd_data.event_type = json_str.substr(event_start, event_end - event_start);
-                cmd_data.is_event_command = true;
+            // Subscriptions only referenced by this table have no clients left
+            const size_t subscription_count = subscriptions.size();
+            subscriptions.erase(std::remove_if(subscriptions.begin(), subscriptions.end(),
+                                               [](const std::shared_ptr<StreamSubscription>& s) { return s.use_count() == 1; }),
+                                subscriptions.end());
+            if (subscriptions.size() != subscription_count) {
+                ReleaseStreamDynamic();
             }
-            
-            // Extract qualifier (optional)
-            size_t qual_pos = json_str.find("\"qualifier\"");
-            if (qual_pos != std::string::npos) {
-                size_t qual_start = json_str.find(":", qual_pos) + 1;
-                qual_start = json_str.find("\"", qual_start) + 1;
-                size_t qual_end = json_str.find("\"", qual_start);
-                cmd_data.qualifier = json_str.substr(qual_start, qual_end - qual_start);
-                
-                // If we have a qualifier, this is an event command
-                cmd_data.is_event_command = true;
+            for (auto& subscription : subscriptions) {
+                StreamSubscription& s = *subscription;
+                std::fill(std::begin(s.needed), std::end(s.needed), false);
+                if (s.aggregator) s.aggregator->Add(frame.all_variables);
+                s.due = s.IsDue(frame.timestamp_us);
+                if (!s.due) continue;
+                const AeroflyFrameData& source = s.CloseWindow(frame);
+                s.delta.Update(source, s.all_variables ? nullptr : s.variables.data(), s.variables.size());
+                s.keyframe_due = (++s.frames_sent % StreamSubscription::KEYFRAME_INTERVAL) == 0;
+                s.last_sent_us = frame.timestamp_us;
             }
             
-            return cmd_data;
-        }
-        
-        tm_external_message TryProcessCoreVariable(const CommandData& cmd_data) {
-            tm_external_message empty_msg;
-            
-            // Process all existing core variables with enhanced event support
-            const std::string& var_name = cmd_data.variable_name;
-            
-            // Controls - Enhanced with event support
-            if (var_name == "Controls.Throttle") {
-                return ProcessCoreMessage(MessageControlsThrottle, cmd_data);
-            }
-            else if (var_name == "Controls.Flaps") {
-                return ProcessCoreMessage(MessageControlsFlaps, cmd_data);
-            }
-            else if (var_name == "Controls.Gear") {
-                return ProcessCoreMessage(MessageControlsGear, cmd_data);
-            }
-            else if (var_name == "Controls.Pitch.Input") {
-                return ProcessCoreMessage(MessageControlsPitchInput, cmd_data);
-            }
-            else if (var_name == "Controls.Roll.Input") {
-                return ProcessCoreMessage(MessageControlsRollInput, cmd_data);
+            // Encode only what somebody is receiving
+            {
+                std::lock_guard<std::mutex> lock(clients_mutex);
+                for (auto& client : data_clients) {
+                    if (!client->subscription || !client->subscription->due) continue;
+                    // A full queue breaks the delta chain: drop the backlog and resync with a keyframe
+                    if (client->delta && client->queue.size() >= BroadcastClient::MAX_QUEUED_FRAMES) {
+                        frames_dropped += client->DropUnsent();
+                    }
+                    client->subscription->needed[ChooseEncoding(*client)] = true;
+                }
             }
-            else if (var_name == "Controls.Yaw.Input") {
-                return ProcessCoreMessage(MessageControlsYawInput, cmd_data);
+            for (auto& subscription : subscriptions) {
+                if (subscription->due) EncodeSubscription(*subscription, *stream_frame);
             }
             
-            // Engine controls
-            else if (var_name == "Controls.Throttle1") {
-                return ProcessCoreMessage(MessageControlsThrottle1, cmd_data);
+            {
+                std::lock_guard<std::mutex> lock(clients_mutex);
+                for (auto& client : data_clients) {
+                    // Clients resolved since the first pass have no subscription yet
+                    if (!client->subscription || !client->subscription->due) continue;
+                    const EncodedFrame& encoded = client->subscription->encoded[ChooseEncoding(*client)];
+                    if (!encoded) continue;
+                    if (!client->Enqueue(encoded)) {
+                        frames_dropped++;
+                    }
+                    client->last_sequence = frame.update_counter;
+                }
             }
-            else if (var_name == "Controls.Throttle2") {
-                return ProcessCoreMessage(MessageControlsThrottle2, cmd_data);
+            for (auto& subscription : subscriptions) {
+                for (EncodedFrame& encoded : subscription->encoded) encoded.reset();
             }
-            else if (var_name == "Controls.Throttle3") {
-                return ProcessCoreMessage(MessageControlsThrottle3, cmd_data);
+            wakeup.Signal();
+        }
+    }
+    
+    // Single network thread: accepts on both listeners, reads commands, and writes queued frames
+    // to data clients whose sockets are writable. Sleeps in the poller until there is work.
+    void ReactorLoop() {
+        OutputDebugStringA("ReactorLoop started\n");
+        
+        while (running) {
+            // Interest set: wakeup, listeners, data clients (write only with a backlog), command clients
+            poller.Clear();
+            poller.Add(wakeup.Socket(), SocketPoller::READABLE);
+            poller.Add(server_socket, SocketPoller::READABLE);
+            poller.Add(command_socket, SocketPoller::READABLE);
+            size_t data_count;
+            {
+                std::lock_guard<std::mutex> lock(clients_mutex);
+                data_count = data_clients.size();
+                for (auto& client : data_clients) {
+                    poller.Add(client->socket, SocketPoller::READABLE |
+                               (client->queue.empty() ? 0u : (uint32_t)SocketPoller::WRITABLE));
+                }
             }
-            else if (var_name == "Controls.Throttle4") {
-                return ProcessCoreMessage(MessageControlsThrottle4, cmd_data);
+            // Stop reading commands while the sim thread has no room for them
+            const bool accept_commands = PushParsedCommands();
+            for (const CommandClient& client : command_clients) {
+                poller.Add(client.socket, (accept_commands ? (uint32_t)SocketPoller::READABLE : 0u) |
+                           (client.outgoing.empty() ? 0u : (uint32_t)SocketPoller::WRITABLE));
             }
             
-            // Brakes
-            else if (var_name == "Controls.WheelBrake.Left") {
-                return ProcessCoreMessage(MessageControlsWheelBrakeLeft, cmd_data);
-            }
-            else if (var_name == "Controls.WheelBrake.Right") {
-                return ProcessCoreMessage(MessageControlsWheelBrakeRight, cmd_data);
-            }
-            else if (var_name == "Controls.AirBrake") {
-                return ProcessCoreMessage(MessageControlsAirBrake, cmd_data);
+            if (poller.Wait(-1) == SOCKET_ERROR) {
+                OutputDebugStringA("Error in WSAPoll()\n");
+                break;
             }
+            if (!running) break;
             
-            // Navigation
-            else if (var_name == "Communication.COM1Frequency") {
-                return ProcessCoreMessage(MessageNavigationCOM1Frequency, cmd_data);
+            if (poller.Events(0)) {
+                wakeup.Drain();
             }
-            else if (var_name == "Navigation.NAV1Frequency") {
-                return ProcessCoreMessage(MessageNavigationNAV1Frequency, cmd_data);
+            
+            // Poll indices follow the lists as they were when the set was built: servicing may drop
+            // data clients, so the command clients' first index comes from data_count
+            const size_t first_data = 3;
+            ServiceDataClients(first_data);
+            ServiceCommandClients(first_data + data_count);
+            
+            // Accept last: new clients are appended to the lists, which must still match the poll set above
+            if (poller.Events(1)) {
+                AcceptClients(server_socket, true);
             }
-            else if (var_name == "Navigation.SelectedCourse1") {
-                return ProcessCoreMessage(MessageNavigationSelectedCourse1, cmd_data);
+            if (poller.Events(2)) {
+                AcceptClients(command_socket, false);
             }
+        }
+        
+        OutputDebugStringA("ReactorLoop finished\n");
+    }
+    
+    void AcceptClients(SOCKET listener, bool data_stream) {
+        for (;;) {
+            SOCKET client_socket = accept(listener, nullptr, nullptr);
+            if (client_socket == INVALID_SOCKET) break;     // WSAEWOULDBLOCK: no more pending connections
+            
+            u_long mode = 1;
+            ioctlsocket(client_socket, FIONBIO, &mode);
             
-            // Autopilot
-            else if (var_name == "Autopilot.SelectedAirspeed") {
-                return ProcessCoreMessage(MessageAutopilotSelectedAirspeed, cmd_data);
+            if (data_stream) {
+                std::lock_guard<std::mutex> lock(clients_mutex);
+                data_clients.push_back(std::make_unique<BroadcastClient>(client_socket, GetTickCount64()));
+                client_count++;
+                OutputDebugStringA("Client connected\n");
+            } else {
+                command_clients.emplace_back(client_socket);
             }
-            else if (var_name == "Autopilot.SelectedHeading") {
-                return ProcessCoreMessage(MessageAutopilotSelectedHeading, cmd_data);
+        }
+    }
+    
+    // poll_index: poller entry of the first data client (same order as data_clients)
+    void ServiceDataClients(size_t poll_index) {
+        std::lock_guard<std::mutex> lock(clients_mutex);
+        
+        auto it = data_clients.begin();
+        while (it != data_clients.end()) {
+            BroadcastClient& client = **it;
+            const uint32_t events = poller.Events(poll_index++);
+            bool failed = (events & SocketPoller::FAILED) != 0;
+            
+            // Data clients only send their handshake line; after that, readable means closed (or junk to discard)
+            if (!failed && (events & SocketPoller::READABLE)) {
+                char scratch[256];
+                const int received = recv(client.socket, scratch, sizeof(scratch), 0);
+                failed = received == 0 || (received == SOCKET_ERROR && WSAGetLastError() != WSAEWOULDBLOCK);
+                if (received > 0) {
+                    client.ReceiveHandshake(scratch, (size_t)received);
+                }
             }
-            else if (var_name == "Autopilot.SelectedAltitude") {
-                return ProcessCoreMessage(MessageAutopilotSelectedAltitude, cmd_data);
+            if (!failed && (events & SocketPoller::WRITABLE)) {
+                failed = client.Flush() == BroadcastClient::FlushResult::Failed;
             }
+            const bool stalled = client.drops_since_send >= BroadcastClient::EVICT_AFTER_DROPS;
             
-            // Add more core variables as needed...
-            
-            return empty_msg; // Not found in core
+            if (failed || stalled) {
+                OutputDebugStringA(stalled ? "Client evicted (not reading data stream)\n" : "Client disconnected\n");
+                (stalled ? clients_evicted : clients_disconnected)++;
+                closesocket(client.socket);
+                it = data_clients.erase(it);
+                client_count--;
+            } else {
+                ++it;
+            }
         }
-        
-        tm_external_message ProcessCoreMessage(tm_external_message& core_message, 
-                                              const CommandData& cmd_data) {
-            try {
-                if (cmd_data.is_event_command) {
-                    // Handle event-based commands
-                    if (cmd_data.event_type == "OnStep" || cmd_data.qualifier == "step") {
-                        core_message.SetValue(cmd_data.value);
-                        HybridLogToFile("Core step event: " + cmd_data.variable_name + 
-                                       " = " + std::to_string(cmd_data.value));
-                    }
-                    else if (cmd_data.event_type == "OnToggle" || cmd_data.qualifier == "toggle") {
-                        core_message.SetValue(1.0); // Trigger value
-                        HybridLogToFile("Core toggle event: " + cmd_data.variable_name);
+    }
+    
+    void ServiceCommandClients(size_t poll_index) {
+        std::vector<std::string> commands;
+        auto it = command_clients.begin();
+        while (it != command_clients.end()) {
+            const uint32_t events = poller.Events(poll_index++);
+            bool open = true;
+            
+            // One recv per wakeup keeps a flooding client from starving the others (poll is level-triggered)
+            if (events & (SocketPoller::READABLE | SocketPoller::FAILED)) {
+                char buffer[16384];
+                const int bytes_received = recv(it->socket, buffer, sizeof(buffer), 0);
+                if (bytes_received != SOCKET_ERROR || WSAGetLastError() != WSAEWOULDBLOCK) {
+                    open = bytes_received > 0;
+                    if (open) {
+                        it->pending.append(buffer, (size_t)bytes_received);
                     }
-                    else if (cmd_data.qualifier == "offset") {
-                        core_message.SetValue(cmd_data.value);
-                        HybridLogToFile("Core offset event: " + cmd_data.variable_name + 
-                                       " offset=" + std::to_string(cmd_data.value));
+                    // Orderly close: the unterminated tail is the last command. Errors drop it.
+                    const size_t first = commands.size();
+                    if (open || bytes_received == 0) {
+                        open = it->Extract(commands, !open) && open;
                     }
-                    else {
-                        core_message.SetValue(cmd_data.value);
-                        HybridLogToFile("Core default event: " + cmd_data.variable_name + 
-                                       " = " + std::to_string(cmd_data.value));
+                    
+                    // Resolve requests are answered here, everything else goes to the sim thread
+                    size_t kept = first;
+                    for (size_t i = first; i < commands.size(); ++i) {
+                        if (AnswerResolve(*it, commands[i])) continue;
+                        if (kept != i) commands[kept] = std::move(commands[i]);
+                        kept++;
                     }
-                } else {
-                    // Standard value command
-                    core_message.SetValue(cmd_data.value);
-                    HybridLogToFile("Core value: " + cmd_data.variable_name + 
-                                   " = " + std::to_string(cmd_data.value));
+                    commands.resize(kept);
                 }
-                
-                return core_message;
-                
-            } catch (const std::exception& e) {
-                HybridLogToFile("ERROR processing core message: " + std::string(e.what()));
-                tm_external_message empty_msg;
-                return empty_msg;
             }
-        }
-        
-        tm_external_message TryProcessHybridVariable(const CommandData& cmd_data) {
-            tm_external_message empty_msg;
+            if (open && !it->outgoing.empty()) {
+                open = it->Flush();
+            }
             
-            try {
-                tm_external_message* hybrid_msg = hybrid_manager->GetMessage(cmd_data.variable_name);
-                if (!hybrid_msg) {
-                    HybridLogToFile("Hybrid variable not found: " + cmd_data.variable_name);
-                    return empty_msg;
-                }
-                
-                // Get variable info for enhanced processing
-                auto var_details = hybrid_manager->GetVariableDetails(cmd_data.variable_name);
-                const EnhancedVariableInfo* var_info = hybrid_manager->FindVariableInfo(cmd_data.variable_name);
-                
-                if (cmd_data.is_event_command && var_info) {
-                    // Process enhanced event command
-                    return ProcessHybridEvent(*hybrid_msg, cmd_data, *var_info);
-                } else {
-                    // Process simple value command
-                    hybrid_msg->SetValue(cmd_data.value);
-                    HybridLogToFile("Hybrid value: " + cmd_data.variable_name + 
-                                   " = " + std::to_string(cmd_data.value));
-                    return *hybrid_msg;
-                }
-                
-            } catch (const std::exception& e) {
-                HybridLogToFile("ERROR processing hybrid variable: " + std::string(e.what()));
-                return empty_msg;
+            if (open) {
+                ++it;
+            } else {
+                closesocket(it->socket);
+                it = command_clients.erase(it);
             }
         }
         
-        tm_external_message ProcessHybridEvent(tm_external_message& hybrid_msg,
-                                              const CommandData& cmd_data,
-                                              const EnhancedVariableInfo& var_info) {
-            
-            HybridLogToFile("Processing hybrid event: " + cmd_data.variable_name + 
-                           " event=" + cmd_data.event_type + " qualifier=" + cmd_data.qualifier);
-            
-            // Validate qualifier
-            if (!cmd_data.qualifier.empty() && !var_info.HasQualifier(cmd_data.qualifier)) {
-                HybridLogToFile("WARNING: Invalid qualifier '" + cmd_data.qualifier + 
-                               "' for variable " + cmd_data.variable_name);
-                // Continue anyway, might still work
+        if (!commands.empty()) {
+            ProcessCommands(commands);
+        }
+    }
+    
+    // {"resolve": ["name", ...]} -> {"handles": [handle or null, ...]} on the same connection
+    bool AnswerResolve(CommandClient& client, const std::string& command) {
+        if (command.find("\"resolve\"") == std::string::npos) return false;
+        bool is_resolve = false;
+        const CommandParseError error = CommandParser::ParseResolve(command, resolve_names, is_resolve);
+        if (!is_resolve) return false;
+        
+        std::string& out = client.outgoing;
+        if (error != CommandParseError::None) {
+            out += "{\"error\":\"";
+            out += CommandParseErrorName(error);
+            out += "\"}\n";
+            return true;
+        }
+        
+        out += "{\"handles\":[";
+        for (size_t i = 0; i < resolve_names.size(); ++i) {
+            if (i > 0) out += ',';
+            const uint32_t handle = ResolveHandle(resolve_names[i]);
+            if (handle == kInvalidHandle) {
+                out += "null";
+            } else {
+                char digits[16];
+                out.append(digits, std::to_chars(digits, digits + sizeof(digits), handle).ptr);
             }
-            
-            try {
-                if (cmd_data.qualifier == "step" && var_info.is_step) {
-                    hybrid_msg.SetValue(cmd_data.value);
-                    HybridLogToFile("Hybrid step: " + cmd_data.variable_name + 
-                                   " step=" + std::to_string(cmd_data.value));
-                }
-                else if (cmd_data.qualifier == "toggle" && var_info.is_toggle) {
-                    hybrid_msg.SetValue(1.0); // Trigger toggle
-                    HybridLogToFile("Hybrid toggle: " + cmd_data.variable_name);
-                }
-                else if (cmd_data.qualifier == "move" && var_info.is_move) {
-                    hybrid_msg.SetValue(cmd_data.value);
-                    HybridLogToFile("Hybrid move: " + cmd_data.variable_name + 
-                                   " rate=" + std::to_string(cmd_data.value));
-                }
-                else if (cmd_data.qualifier == "offset" && var_info.is_offset) {
-                    hybrid_msg.SetValue(cmd_data.value);
-                    HybridLogToFile("Hybrid offset: " + cmd_data.variable_name + 
-                                   " offset=" + std::to_string(cmd_data.value));
-                }
-                else if (cmd_data.qualifier == "active" && var_info.is_active) {
-                    hybrid_msg.SetValue(cmd_data.value);
-                    HybridLogToFile("Hybrid active: " + cmd_data.variable_name + 
-                                   " active=" + std::to_string(cmd_data.value));
-                }
-                else {
-                    // Default: standard value setting
-                    hybrid_msg.SetValue(cmd_data.value);
-                    HybridLogToFile("Hybrid default: " + cmd_data.variable_name + 
-                                   " = " + std::to_string(cmd_data.value));
-                }
-                
-                return hybrid_msg;
-                
-            } catch (const std::exception& e) {
-                HybridLogToFile("ERROR in hybrid event processing: " + std::string(e.what()));
-                tm_external_message empty_msg;
-                return empty_msg;
+        }
+        out += "]}\n";
+        return true;
+    }
+    
+    uint32_t ResolveHandle(std::string_view name) const {
+        return ResolveVariableHandle(MessageNameHash(name), hybrid_manager);
+    }
+    
+    // Parses and encodes a batch here, so the sim thread only copies finished messages
+    void ProcessCommands(std::vector<std::string>& commands) {
+        if (!command_processor) return;
+        command_processor->ProcessCommands(commands, parsed_messages, parsed_runs);
+        PushParsedCommands();
+    }
+    
+    // Moves parsed runs into the command queue in order; false if some are still waiting for room.
+    // Ordinary runs may go in several pieces, same_frame runs only whole.
+    bool PushParsedCommands() {
+        size_t message = 0;
+        size_t run_index = 0;
+        while (run_index < parsed_runs.size()) {
+            CommandRun& run = parsed_runs[run_index];
+            if (run.same_frame && run.count > CommandQueue::CAPACITY) {
+                HybridLogToFile("ERROR: same_frame batch of " + std::to_string(run.count) +
+                                " commands exceeds the command queue, dropped");
+                message += run.count;
+                ++run_index;
+                continue;
             }
+            const uint32_t piece = std::min(run.count, CommandQueue::CAPACITY);
+            if (!command_queue.TryPush(&parsed_messages[message], piece, run.same_frame)) break;
+            message += piece;
+            run.count -= piece;
+            if (run.count == 0) ++run_index;
         }
         
-        void UpdateCommandStats(const std::string& command) {
-            try {
-                std::lock_guard<std::mutex> lock(stats_mutex);
-                
-                // Extract variable name for stats
-                size_t var_pos = command.find("\"variable\"");
-                if (var_pos != std::string::npos) {
-                    size_t var_start = command.find(":", var_pos);
-                    size_t var_name_start = command.find("\"", var_start) + 1;
-                    size_t var_name_end = command.find("\"", var_name_start);
-                    
-                    if (var_name_end != std::string::npos) {
-                        std::string var_name = command.substr(var_name_start, 
-                                                             var_name_end - var_name_start);
-                        command_stats[var_name]++;
-                    }
-                }
-            } catch (...) {
-                // Ignore stats errors
-            }
+        parsed_messages.erase(parsed_messages.begin(), parsed_messages.begin() + message);
+        parsed_runs.erase(parsed_runs.begin(), parsed_runs.begin() + run_index);
+        if (parsed_runs.empty()) return true;
+        commands_stalled.store(true, std::memory_order_release);
+        return false;
+    }
+    
+public:
+    void SetCommandProcessor(EnhancedCommandProcessor* processor) {
+        command_processor = processor;
+    }
+    
+    // Sim thread: appends the commands queued since the last call; wakes the reactor if it stopped
+    // reading because the queue was full
+    void DrainCommands(std::vector<tm_external_message>& messages, std::vector<CommandRun>& runs) {
+        command_queue.Drain(messages, runs);
+        if (commands_stalled.load(std::memory_order_acquire) && commands_stalled.exchange(false)) {
+            wakeup.Signal();
         }
-    };
+    }
+    
+    int GetClientCount() const {
+        return client_count.load(std::memory_order_relaxed);
+    }
+};
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 // MAIN BRIDGE CONTROLLER
@@ -3675,6 +6688,11 @@ private:
     HybridVariableManager hybrid_manager;  // ✅ AGREGADO: Sistema híbrido
     bool initialized;
     
+    // Command messages waiting for room in the simulator's output buffer, oldest first
+    std::vector<tm_external_message> pending_messages;
+    std::vector<CommandRun> pending_runs;
+    CommandCoalescer coalescer;
+    
 public:
     AeroflyBridge() : initialized(false) {}
     
@@ -3694,10 +6712,13 @@ public:
             
             // ✅ NUEVO: Connect hybrid system to command processor
             command_processor.SetHybridManager(&hybrid_manager);
+            shared_memory.SetHybridManager(&hybrid_manager);
+            tcp_server.SetHybridManager(&hybrid_manager);
             OutputDebugStringA("SUCCESS: Hybrid system connected to CommandProcessor\n");
         }
         
         // Start TCP server (optional, for network access)
+        tcp_server.SetCommandProcessor(&command_processor);
         if (!tcp_server.Start(12345, 12346)) {
             // TCP server failure is not critical
             // Shared memory still works
@@ -3707,8 +6728,9 @@ public:
         return true;
     }
     
-    void Update(const std::vector<tm_external_message>& received_messages, double delta_time,
-                std::vector<tm_external_message>& sent_messages) {
+    // sent_capacity: bytes available in the simulator's output buffer this frame
+    void Update(const MessageStreamView& received_messages, double delta_time,
+                std::vector<tm_external_message>& sent_messages, tm_uint32 sent_capacity) {
         if (!initialized) return;
         
         // Update shared memory with latest data
@@ -3719,12 +6741,67 @@ public:
             tcp_server.BroadcastData(shared_memory.GetData());
         }
         
-        // Process any pending commands
-        auto commands = tcp_server.GetPendingCommands();
-        if (!commands.empty()) {
-            auto command_messages = command_processor.ProcessCommands(commands);
-            sent_messages.insert(sent_messages.end(), command_messages.begin(), command_messages.end());
+        // Commands from the network arrive already encoded
+        tcp_server.DrainCommands(pending_messages, pending_runs);
+        DrainCommandRing();
+        coalescer.Coalesce(pending_messages, pending_runs);
+        EmitPendingCommands(sent_messages, sent_capacity);
+    }
+    
+    // Takes at most one ring's worth per frame so producers can't keep the sim thread here. A
+    // completion means the command was queued for the simulator (this frame unless the output
+    // buffer is full), or rejected.
+    void DrainCommandRing() {
+        AeroflyCommandRing* ring = shared_memory.GetCommandRing();
+        if (!ring) return;
+        
+        const uint32_t frame = shared_memory.GetData()->update_counter;
+        AeroflyCommand command;
+        for (uint32_t i = 0; i < AeroflyCommandRing::CAPACITY && ring->TryPop(command); i++) {
+            const AeroflyCommandStatus status = command_processor.ProcessRingCommand(command, pending_messages, pending_runs);
+            ring->Complete(command, status, frame);
+        }
+    }
+    
+    // Moves as many pending messages as fit in this frame's output buffer, in order. A run that
+    // doesn't fit completely waits for the next frame; ordinary runs may be split at the boundary,
+    // same_frame runs never are.
+    void EmitPendingCommands(std::vector<tm_external_message>& sent_messages, tm_uint32 capacity) {
+        size_t message = 0;
+        size_t run_index = 0;
+        tm_uint32 used = 0;
+        
+        for (; run_index < pending_runs.size(); ++run_index) {
+            CommandRun& run = pending_runs[run_index];
+            if (run.same_frame) {
+                tm_uint32 run_bytes = 0;
+                for (size_t i = message; i < message + run.count; ++i) {
+                    run_bytes += pending_messages[i].GetSize();
+                }
+                if (run_bytes > capacity) {
+                    // Could never be sent in one frame
+                    HybridLogToFile("ERROR: same_frame batch of " + std::to_string(run.count) +
+                                    " commands exceeds the output buffer, dropped");
+                    message += run.count;
+                    continue;
+                }
+                if (used + run_bytes > capacity) break;
+                sent_messages.insert(sent_messages.end(), pending_messages.begin() + message,
+                                     pending_messages.begin() + message + run.count);
+                used += run_bytes;
+                message += run.count;
+            } else {
+                while (run.count > 0 && used + pending_messages[message].GetSize() <= capacity) {
+                    used += pending_messages[message].GetSize();
+                    sent_messages.push_back(pending_messages[message++]);
+                    run.count--;
+                }
+                if (run.count > 0) break;
+            }
         }
+        
+        pending_messages.erase(pending_messages.begin(), pending_messages.begin() + message);
+        pending_runs.erase(pending_runs.begin(), pending_runs.begin() + run_index);
     }
     
     void Shutdown() {
@@ -3755,7 +6832,6 @@ public:
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
 static AeroflyBridge* g_bridge = nullptr;
-static std::vector<tm_external_message> MessageListReceive;
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 // AEROFLY FS4 DLL INTERFACE
@@ -3828,17 +6904,14 @@ extern "C" {
         }
 
         try {
-            // Parse received messages
-            MessageListReceive.clear();
-            tm_uint32 pos = 0;
-            for (tm_uint32 i = 0; i < message_list_received_num_messages; ++i) {
-                auto msg = tm_external_message::GetFromByteStream(message_list_received_byte_stream, pos);
-                MessageListReceive.emplace_back(msg);
-            }
+            // Decode received messages straight from the simulator's buffer (no per-message copy)
+            const MessageStreamView received(message_list_received_byte_stream,
+                                             message_list_received_byte_stream_size,
+                                             message_list_received_num_messages);
 
             // Process messages and get commands to send back
             std::vector<tm_external_message> sent_messages;
-            g_bridge->Update(MessageListReceive, delta_time, sent_messages);
+            g_bridge->Update(received, delta_time, sent_messages, message_list_sent_byte_stream_size_max);
 
             // Build response message list
             message_list_sent_byte_stream_size = 0;
@@ -3877,12 +6950,17 @@ extern "C" {
 // ✅ Error handling
 //
 // TCP Ports:
-// - 12345: Data streaming (JSON)
-// - 12346: Commands (JSON)
+// - 12345: Data streaming (JSON, or binary frames after a "BINARY" handshake line; "DELTA" for changes only,
+//          VARS=/RATE=/AGG= for a subscription)
+// - 12346: Commands (JSON, one per line or "<length>:" prefixed; connections stay open)
 //
 // Shared Memory:
 // - Name: "AeroflyBridgeData"
-// - Size: ~3384 bytes
+// - Size: ~470 KB (layout v3: 4352-byte frame, then dynamic values, catalog and hybrid info pages)
 // - Access: Direct memory mapping
+// - Name: "AeroflyBridgeFrames" (triple-buffered copies of the frame part)
+// - Name: "AeroflyBridgeHistory" (ring of the last 512 frames of all_variables)
+// - Name: "AeroflyBridgeSchema" (name/offset/type/count/unit of every field and all_variables slot)
+// - Name: "AeroflyBridgeCommands" (lock-free command queue and completion ring for same-host clients)
 //
 ///////////////////////////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
@@ -3,6 +3,12 @@ import mmap
 import struct
 import time
 import os
+import io
+
+SCHEMA_MAGIC = 0x43534641                  # "AFSC"
+SCHEMA_HEADER = struct.Struct('<8I')       # magic, version, layout_version, data_size, frame_size, entry_count, entry_size, field_count
+SCHEMA_ENTRY = struct.Struct('<64sIIHHHHH') # name, offset, size, type, count, unit, data_type, variable_index
+SCHEMA_HEADER_SIZE = 64
 
 def read_double(shared_memory, offset):
     try:
@@ -28,6 +34,48 @@ def read_uint64(shared_memory, offset):
     except:
         return 0
 
+def load_schema():
+    """Read the AeroflyBridgeSchema mapping: returns frame_size and {field name: (offset, size, count)}"""
+    header_map = mmap.mmap(-1, SCHEMA_HEADER_SIZE, "AeroflyBridgeSchema")
+    magic, version, layout_version, data_size, frame_size, entry_count, entry_size, field_count = \
+        SCHEMA_HEADER.unpack_from(header_map, 0)
+    header_map.close()
+    if magic != SCHEMA_MAGIC:
+        raise RuntimeError("AeroflyBridgeSchema not available (bridge not running?)")
+
+    schema_map = mmap.mmap(-1, SCHEMA_HEADER_SIZE + entry_count * entry_size, "AeroflyBridgeSchema")
+    fields = {}
+    for i in range(field_count):
+        name, offset, size, field_type, count, unit, data_type, variable_index = \
+            SCHEMA_ENTRY.unpack_from(schema_map, SCHEMA_HEADER_SIZE + i * entry_size)
+        fields[name.split(b'\0', 1)[0].decode()] = (offset, size, count)
+    schema_map.close()
+    return frame_size, fields
+
+def resolve_offset(fields, spec):
+    """'latitude', 'position.x', 'engine_throttle[1]', 'all_variables[25]' -> byte offset"""
+    name, _, component = spec.partition('.')
+    index = 0
+    if name.endswith(']'):
+        name, index = name[:-1].split('[')
+        index = int(index)
+    offset, size, count = fields[name]
+    offset += index * (size // count)
+    if component:
+        offset += 'xyz'.index(component) * 8
+    return offset
+
+def read_consistent_frame(shared_memory, frame_size, sequence_offset):
+    """Copy the frame while no frame is being written (odd sequence = write in progress)"""
+    while True:
+        begin = read_uint32(shared_memory, sequence_offset)
+        if begin % 2 == 0:
+            shared_memory.seek(0)
+            frame = shared_memory.read(frame_size)
+            if read_uint32(shared_memory, sequence_offset) == begin:
+                return io.BytesIO(frame)
+        time.sleep(0)
+
 def clear_screen():
     os.system('cls' if os.name == 'nt' else 'clear')
 
@@ -66,133 +114,141 @@ def main():
     # TODAS LAS VARIABLES CONFIRMADAS (basadas en el scanner)
     all_variables = {
         # === ESTRUCTURA FIJA ===
-        'Aircraft.Latitude': 16,
-        'Aircraft.Longitude': 24,
-        'Aircraft.Altitude': 32,
-        'Aircraft.Pitch': 40,
-        'Aircraft.Bank': 48,
-        'Aircraft.TrueHeading': 56,
-        'Aircraft.MagneticHeading': 64,
-        'Aircraft.IndicatedAirspeed': 72,
-        'Aircraft.GroundSpeed': 80,
-        'Aircraft.VerticalSpeed': 88,
-        'Aircraft.AngleOfAttack': 96,
-        'Aircraft.MachNumber': 112,
-        'Aircraft.RateOfTurn': 120,
-        'Aircraft.Position.X': 128,
-        'Aircraft.Position.Y': 136,
-        'Aircraft.Position.Z': 144,
-        'Aircraft.Velocity.X': 152,
-        'Aircraft.Velocity.Y': 160,
-        'Aircraft.Velocity.Z': 168,
-        'Aircraft.Acceleration.X': 176,
-        'Aircraft.Acceleration.Y': 184,
-        'Aircraft.Acceleration.Z': 192,
-        'Aircraft.AngularVel.X': 200,
-        'Aircraft.AngularVel.Y': 208,
-        'Aircraft.AngularVel.Z': 216,
-        'Aircraft.Wind.X': 224,
-        'Aircraft.Wind.Y': 232,
-        'Aircraft.Wind.Z': 240,
-        'Aircraft.Gravity.X': 248,
-        'Aircraft.Gravity.Y': 256,
-        'Aircraft.Gravity.Z': 264,
-        'Aircraft.OnGround': 272,
-        'Aircraft.OnRunway': 280,
-        'Aircraft.Flaps': 304,
-        'Aircraft.Throttle': 320,
-        'Aircraft.EngineThrottle1': 336,
-        'Aircraft.EngineThrottle2': 344,
-        'Aircraft.EngineRotationSpeed1': 368,
-        'Aircraft.EngineRotationSpeed2': 376,
-        'Aircraft.EngineRunning1': 400,
-        'Aircraft.EngineRunning2': 408,
-        'Controls.Pitch.Input': 432,
-        'Controls.Roll.Input': 440,
-        'Communication.COM1Freq': 456,
-        'Communication.COM1Standby': 464,
-        'Communication.COM2Freq': 472,
-        'Communication.COM2Standby': 480,
-        'Navigation.NAV1Freq': 488,
-        'Navigation.NAV1Standby': 496,
-        'Navigation.NAV1Course': 504,
-        'Navigation.NAV2Freq': 512,
-        'Navigation.NAV2Standby': 520,
-        'Navigation.NAV2Course': 528,
-        'Autopilot.Engaged': 536,
-        'Autopilot.SelectedHeading': 552,
-        'Autopilot.SelectedAltitude': 560,
-        'Autopilot.SelectedVS': 568,
-        'Performance.VS0': 616,
-        'Performance.VS1': 624,
-        'Performance.VFE': 632,
-        'Performance.VNO': 640,
-        'Performance.VNE': 648,
+        'Aircraft.Latitude': 'latitude',
+        'Aircraft.Longitude': 'longitude',
+        'Aircraft.Altitude': 'altitude',
+        'Aircraft.Pitch': 'pitch',
+        'Aircraft.Bank': 'bank',
+        'Aircraft.TrueHeading': 'true_heading',
+        'Aircraft.MagneticHeading': 'magnetic_heading',
+        'Aircraft.IndicatedAirspeed': 'indicated_airspeed',
+        'Aircraft.GroundSpeed': 'ground_speed',
+        'Aircraft.VerticalSpeed': 'vertical_speed',
+        'Aircraft.AngleOfAttack': 'angle_of_attack',
+        'Aircraft.MachNumber': 'mach_number',
+        'Aircraft.RateOfTurn': 'rate_of_turn',
+        'Aircraft.Position.X': 'position.x',
+        'Aircraft.Position.Y': 'position.y',
+        'Aircraft.Position.Z': 'position.z',
+        'Aircraft.Velocity.X': 'velocity.x',
+        'Aircraft.Velocity.Y': 'velocity.y',
+        'Aircraft.Velocity.Z': 'velocity.z',
+        'Aircraft.Acceleration.X': 'acceleration.x',
+        'Aircraft.Acceleration.Y': 'acceleration.y',
+        'Aircraft.Acceleration.Z': 'acceleration.z',
+        'Aircraft.AngularVel.X': 'angular_velocity.x',
+        'Aircraft.AngularVel.Y': 'angular_velocity.y',
+        'Aircraft.AngularVel.Z': 'angular_velocity.z',
+        'Aircraft.Wind.X': 'wind.x',
+        'Aircraft.Wind.Y': 'wind.y',
+        'Aircraft.Wind.Z': 'wind.z',
+        'Aircraft.Gravity.X': 'gravity.x',
+        'Aircraft.Gravity.Y': 'gravity.y',
+        'Aircraft.Gravity.Z': 'gravity.z',
+        'Aircraft.OnGround': 'on_ground',
+        'Aircraft.OnRunway': 'on_runway',
+        'Aircraft.Flaps': 'flaps_position',
+        'Aircraft.Throttle': 'throttle_position',
+        'Aircraft.EngineThrottle1': 'engine_throttle[0]',
+        'Aircraft.EngineThrottle2': 'engine_throttle[1]',
+        'Aircraft.EngineRotationSpeed1': 'engine_rotation_speed[0]',
+        'Aircraft.EngineRotationSpeed2': 'engine_rotation_speed[1]',
+        'Aircraft.EngineRunning1': 'engine_running[0]',
+        'Aircraft.EngineRunning2': 'engine_running[1]',
+        'Controls.Pitch.Input': 'pitch_input',
+        'Controls.Roll.Input': 'roll_input',
+        'Communication.COM1Freq': 'com1_frequency',
+        'Communication.COM1Standby': 'com1_standby_frequency',
+        'Communication.COM2Freq': 'com2_frequency',
+        'Communication.COM2Standby': 'com2_standby_frequency',
+        'Navigation.NAV1Freq': 'nav1_frequency',
+        'Navigation.NAV1Standby': 'nav1_standby_frequency',
+        'Navigation.NAV1Course': 'nav1_selected_course',
+        'Navigation.NAV2Freq': 'nav2_frequency',
+        'Navigation.NAV2Standby': 'nav2_standby_frequency',
+        'Navigation.NAV2Course': 'nav2_selected_course',
+        'Autopilot.Engaged': 'ap_engaged',
+        'Autopilot.SelectedHeading': 'ap_selected_heading',
+        'Autopilot.SelectedAltitude': 'ap_selected_altitude',
+        'Autopilot.SelectedVS': 'ap_selected_vs',
+        'Performance.VS0': 'vs0_speed',
+        'Performance.VS1': 'vs1_speed',
+        'Performance.VFE': 'vfe_speed',
+        'Performance.VNO': 'vno_speed',
+        'Performance.VNE': 'vne_speed',
         
-        # === VARIABLES DEL ARRAY (672 + index * 8) ===
-        'Array[1].Altitude': 672 + (1 * 8),
-        'Array[2].VerticalSpeed': 672 + (2 * 8),
-        'Array[3].Pitch': 672 + (3 * 8),
-        'Array[4].Bank': 672 + (4 * 8),
-        'Array[5].IAS': 672 + (5 * 8),
-        'Array[6].IASTrend': 672 + (6 * 8),
-        'Array[7].GroundSpeed': 672 + (7 * 8),
-        'Array[8].MagHeading': 672 + (8 * 8),
-        'Array[9].TrueHeading': 672 + (9 * 8),
-        'Array[10].Latitude': 672 + (10 * 8),
-        'Array[11].Longitude': 672 + (11 * 8),
-        'Array[12].Height': 672 + (12 * 8),
-        'Array[20].RateOfTurn': 672 + (20 * 8),
-        'Array[21].MachNumber': 672 + (21 * 8),
-        'Array[22].AngleOfAttack': 672 + (22 * 8),
-        'Array[26].Flaps': 672 + (26 * 8),
-        'Array[28].Throttle': 672 + (28 * 8),
-        'Array[52].OnGround': 672 + (52 * 8),
-        'Array[53].OnRunway': 672 + (53 * 8),
-        'Array[78].EngineMaster1': 672 + (78 * 8),
-        'Array[79].EngineMaster2': 672 + (79 * 8),
-        'Array[82].EngineThrottle1': 672 + (82 * 8),
-        'Array[83].EngineThrottle2': 672 + (83 * 8),
-        'Array[86].EngineRPM1': 672 + (86 * 8),
-        'Array[87].EngineRPM2': 672 + (87 * 8),
-        'Array[90].EngineRunning1': 672 + (90 * 8),
-        'Array[91].EngineRunning2': 672 + (91 * 8),
-        'Array[95].VS0': 672 + (95 * 8),
-        'Array[96].VS1': 672 + (96 * 8),
-        'Array[97].VFE': 672 + (97 * 8),
-        'Array[98].VNO': 672 + (98 * 8),
-        'Array[99].VNE': 672 + (99 * 8),
-        'Array[108].SelectedCourse1': 672 + (108 * 8),
-        'Array[109].SelectedCourse2': 672 + (109 * 8),
-        'Array[111].NAV1Freq': 672 + (111 * 8),
-        'Array[112].NAV1Standby': 672 + (112 * 8),
-        'Array[115].NAV2Freq': 672 + (115 * 8),
-        'Array[116].NAV2Standby': 672 + (116 * 8),
-        'Array[142].COM1Freq': 672 + (142 * 8),
-        'Array[143].COM1Standby': 672 + (143 * 8),
-        'Array[145].COM2Freq': 672 + (145 * 8),
-        'Array[146].COM2Standby': 672 + (146 * 8),
-        'Array[159].AP.SelectedHeading': 672 + (159 * 8),
-        'Array[160].AP.SelectedAltitude': 672 + (160 * 8),
-        'Array[161].AP.SelectedVS': 672 + (161 * 8),
-        'Array[172].AP.Engaged': 672 + (172 * 8),
-        'Array[201].Controls.Pitch': 672 + (201 * 8),
-        'Array[203].Controls.Roll': 672 + (203 * 8),
-        'Array[207].Controls.Flaps': 672 + (207 * 8),
+        # === VARIABLES DEL ARRAY (all_variables[index]) ===
+        'Array[1].Altitude': 'all_variables[1]',
+        'Array[2].VerticalSpeed': 'all_variables[2]',
+        'Array[3].Pitch': 'all_variables[3]',
+        'Array[4].Bank': 'all_variables[4]',
+        'Array[5].IAS': 'all_variables[5]',
+        'Array[6].IASTrend': 'all_variables[6]',
+        'Array[7].GroundSpeed': 'all_variables[7]',
+        'Array[8].MagHeading': 'all_variables[8]',
+        'Array[9].TrueHeading': 'all_variables[9]',
+        'Array[10].Latitude': 'all_variables[10]',
+        'Array[11].Longitude': 'all_variables[11]',
+        'Array[12].Height': 'all_variables[12]',
+        'Array[20].RateOfTurn': 'all_variables[20]',
+        'Array[21].MachNumber': 'all_variables[21]',
+        'Array[22].AngleOfAttack': 'all_variables[22]',
+        'Array[26].Flaps': 'all_variables[26]',
+        'Array[28].Throttle': 'all_variables[28]',
+        'Array[52].OnGround': 'all_variables[52]',
+        'Array[53].OnRunway': 'all_variables[53]',
+        'Array[78].EngineMaster1': 'all_variables[78]',
+        'Array[79].EngineMaster2': 'all_variables[79]',
+        'Array[82].EngineThrottle1': 'all_variables[82]',
+        'Array[83].EngineThrottle2': 'all_variables[83]',
+        'Array[86].EngineRPM1': 'all_variables[86]',
+        'Array[87].EngineRPM2': 'all_variables[87]',
+        'Array[90].EngineRunning1': 'all_variables[90]',
+        'Array[91].EngineRunning2': 'all_variables[91]',
+        'Array[95].VS0': 'all_variables[95]',
+        'Array[96].VS1': 'all_variables[96]',
+        'Array[97].VFE': 'all_variables[97]',
+        'Array[98].VNO': 'all_variables[98]',
+        'Array[99].VNE': 'all_variables[99]',
+        'Array[108].SelectedCourse1': 'all_variables[108]',
+        'Array[109].SelectedCourse2': 'all_variables[109]',
+        'Array[111].NAV1Freq': 'all_variables[111]',
+        'Array[112].NAV1Standby': 'all_variables[112]',
+        'Array[115].NAV2Freq': 'all_variables[115]',
+        'Array[116].NAV2Standby': 'all_variables[116]',
+        'Array[142].COM1Freq': 'all_variables[142]',
+        'Array[143].COM1Standby': 'all_variables[143]',
+        'Array[145].COM2Freq': 'all_variables[145]',
+        'Array[146].COM2Standby': 'all_variables[146]',
+        'Array[159].AP.SelectedHeading': 'all_variables[159]',
+        'Array[160].AP.SelectedAltitude': 'all_variables[160]',
+        'Array[161].AP.SelectedVS': 'all_variables[161]',
+        'Array[172].AP.Engaged': 'all_variables[172]',
+        'Array[201].Controls.Pitch': 'all_variables[201]',
+        'Array[203].Controls.Roll': 'all_variables[203]',
+        'Array[207].Controls.Flaps': 'all_variables[207]',
     }
     
     try:
-        shared_memory = mmap.mmap(-1, 3384, "AeroflyBridgeData")
+        # Offsets come from the bridge's schema, so layout changes do not break the monitor
+        frame_size, fields = load_schema()
+        offsets = [(name, resolve_offset(fields, spec)) for name, spec in all_variables.items()]
+        sequence_offset = resolve_offset(fields, 'frame_sequence')
+        header_offsets = [resolve_offset(fields, f) for f in ('data_valid', 'update_counter', 'timestamp_us')]
+        shared_memory = mmap.mmap(-1, frame_size, "AeroflyBridgeData")
         
         while True:
             clear_screen()
             print("=== AEROFLY COMPLETE VARIABLE MONITOR ===")
             print(f"Timestamp: {time.strftime('%H:%M:%S')}")
             
+            # All values below come from the same simulator frame
+            frame = read_consistent_frame(shared_memory, frame_size, sequence_offset)
+            
             # Header info
-            data_valid = read_uint32(shared_memory, 8)
-            update_counter = read_uint32(shared_memory, 12)
-            timestamp = read_uint64(shared_memory, 0)
+            data_valid = read_uint32(frame, header_offsets[0])
+            update_counter = read_uint32(frame, header_offsets[1])
+            timestamp = read_uint64(frame, header_offsets[2])
             
             print(f"Data Valid: {'✅ YES' if data_valid == 1 else '❌ NO'} | Update Counter: {update_counter} | Timestamp: {timestamp}")
             print()
@@ -203,7 +259,7 @@ def main():
                 continue
             
             # Display variables in 4 columns
-            variables_list = list(all_variables.items())
+            variables_list = offsets
             
             # Header for columns
             print(f"{'Variable':25s} | {'Value':12s} | {'Variable':25s} | {'Value':12s} | {'Variable':25s} | {'Value':12s} | {'Variable':25s} | {'Value':12s}")
@@ -216,7 +272,7 @@ def main():
                 for j in range(4):
                     if i + j < len(variables_list):
                         name, offset = variables_list[i + j]
-                        value = read_double(shared_memory, offset)
+                        value = read_double(frame, offset)
                         formatted_value = format_value(name, value)
                         row_data.extend([name[:24], formatted_value])
                     else:
@@ -4,6 +4,8 @@ import struct
 import time
 import os
 
+from aerofly_realtime_monitor_all import load_schema, resolve_offset
+
 def read_double(shared_memory, offset):
     try:
         shared_memory.seek(offset)
@@ -30,7 +32,8 @@ def main():
     print()
     
     try:
-        shared_memory = mmap.mmap(-1, 3384, "AeroflyBridgeData")
+        frame_size, fields = load_schema()
+        shared_memory = mmap.mmap(-1, frame_size, "AeroflyBridgeData")
         
         while True:
             clear_screen()
@@ -38,8 +41,8 @@ def main():
             print(f"Timestamp: {time.strftime('%H:%M:%S')}")
             
             # Header info
-            data_valid = read_uint32(shared_memory, 8)
-            update_counter = read_uint32(shared_memory, 12)
+            data_valid = read_uint32(shared_memory, resolve_offset(fields, 'data_valid'))
+            update_counter = read_uint32(shared_memory, resolve_offset(fields, 'update_counter'))
             
             print(f"Data Valid: {'✅ YES' if data_valid == 1 else '❌ NO'} | Update Counter: {update_counter}")
             print()
@@ -50,7 +53,7 @@ def main():
                 continue
             
             # Read ALL 339 variables from array
-            base_offset = 672
+            base_offset = resolve_offset(fields, 'all_variables')
             active_count = 0
             zero_count = 0
             